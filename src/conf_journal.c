@@ -0,0 +1,293 @@
+#include <stdbool.h> // bool
+#include <stdint.h> // uint8_t, uint16_t, uint32_t
+#include <string.h> // memset, memcpy
+
+#include "./scroll_controller.h"
+#include "./conf_journal.h"
+
+// Every record starts with this byte, erased flash reads as all ones
+#define JOURNAL_MAGIC 0x4A
+#define JOURNAL_ERASED 0xFF
+
+// Record layout is magic byte, 4 byte sequence number, 2 byte address, 2 byte length, data and 2 byte CRC
+#define JOURNAL_HEADERLEN 9
+#define JOURNAL_CRCLEN 2
+
+// Every sector starts with a snapshot record containing the entire configuration
+#define JOURNAL_SNAPSHOTLEN (JOURNAL_HEADERLEN + VERBALEYES_CONFIGLEN + JOURNAL_CRCLEN)
+
+// Free space kept at the end of the active sector for commits, less than this is compacted in the background
+#define JOURNAL_RESERVE (JOURNAL_HEADERLEN + 64 + JOURNAL_CRCLEN)
+
+// Number of bytes read from flash at a time when calculating CRC
+#define JOURNAL_CHUNKLEN 32
+
+// Sector index used before any snapshot has been written
+#define JOURNAL_NOSECTOR 0xFF
+
+#if VERBALEYES_JOURNAL_SECTORSIZE < VERBALEYES_CONFIGLEN + 11
+#error "VERBALEYES_JOURNAL_SECTORSIZE is too small to fit a snapshot of the configuration"
+#endif
+
+#if VERBALEYES_JOURNAL_SECTORS < 2 || VERBALEYES_JOURNAL_SECTORS >= JOURNAL_NOSECTOR
+#error "VERBALEYES_JOURNAL_SECTORS has to be between 2 and 254"
+#endif
+
+// Configuration mirrored in RAM, reads and writes never touch flash
+static char journalImage[VERBALEYES_CONFIGLEN];
+
+// Configuration as it is in flash, records and snapshots are made from this so writes are not stored until committed
+static char journalCommitted[VERBALEYES_CONFIGLEN];
+
+// Position of the end of the journal
+static bool journalMounted = false;
+static uint8_t journalSector = JOURNAL_NOSECTOR;
+static uint32_t journalPos = 0;
+static uint32_t journalSeq = 0;
+
+// Indicates that the sector after the active sector is erased and ready to compact into
+static bool journalSpareErased = false;
+
+// Record header decoded from flash
+struct journalRecord {
+	uint32_t seq;
+	uint16_t addr;
+	uint16_t len;
+};
+
+
+
+// Updates CRC-16/CCITT-FALSE with a single byte
+static uint16_t crc16(uint16_t crc, const uint8_t c) {
+	crc ^= c << 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+// Gets the sector compaction writes its snapshot into
+static uint8_t journalNextSector() {
+	return (journalSector == JOURNAL_NOSECTOR) ? 0 : (journalSector + 1) % VERBALEYES_JOURNAL_SECTORS;
+}
+
+// Gets the number of bytes a record uses in flash
+static uint32_t journalRecordSize(const uint16_t len) {
+	return JOURNAL_HEADERLEN + len + JOURNAL_CRCLEN;
+}
+
+// Reads record header at flash address, returns the first byte to distinguish erased flash from broken records
+static uint8_t journalReadHeader(const uint32_t addr, struct journalRecord* record) {
+	uint8_t header[JOURNAL_HEADERLEN];
+	verbaleyes_flash_read(addr, header, JOURNAL_HEADERLEN);
+	record->seq = ((uint32_t)header[1] << 24) | ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 8) | header[4];
+	record->addr = (header[5] << 8) | header[6];
+	record->len = (header[7] << 8) | header[8];
+	if (header[0] != JOURNAL_MAGIC) return header[0];
+
+	// Treats records outside configuration range as broken
+	if (record->addr >= VERBALEYES_CONFIGLEN || record->len > VERBALEYES_CONFIGLEN - record->addr) return 0;
+	return JOURNAL_MAGIC;
+}
+
+// Validates the CRC of a record, calculated over both header and data
+static bool journalCheckRecord(const uint32_t addr, const struct journalRecord* record) {
+	uint8_t chunk[JOURNAL_CHUNKLEN];
+	const uint32_t len = JOURNAL_HEADERLEN + record->len;
+	uint16_t crc = 0xFFFF;
+	uint32_t i = 0;
+	while (i < len) {
+		const uint16_t chunkLen = (len - i > JOURNAL_CHUNKLEN) ? JOURNAL_CHUNKLEN : len - i;
+		verbaleyes_flash_read(addr + i, chunk, chunkLen);
+		for (uint16_t j = 0; j < chunkLen; j++) crc = crc16(crc, chunk[j]);
+		i += chunkLen;
+	}
+	verbaleyes_flash_read(addr + len, chunk, JOURNAL_CRCLEN);
+	return crc == ((chunk[0] << 8) | chunk[1]);
+}
+
+// Appends a record for a range of the configuration at flash address
+static void journalAppend(const uint32_t at, const uint16_t addr, const uint16_t len) {
+	journalSeq++;
+
+	// Creates header
+	uint8_t header[JOURNAL_HEADERLEN];
+	header[0] = JOURNAL_MAGIC;
+	header[1] = journalSeq >> 24;
+	header[2] = journalSeq >> 16;
+	header[3] = journalSeq >> 8;
+	header[4] = journalSeq;
+	header[5] = addr >> 8;
+	header[6] = addr;
+	header[7] = len >> 8;
+	header[8] = len;
+
+	// Calculates CRC over header and data
+	uint16_t crc = 0xFFFF;
+	for (uint8_t i = 0; i < JOURNAL_HEADERLEN; i++) crc = crc16(crc, header[i]);
+	for (uint16_t i = 0; i < len; i++) crc = crc16(crc, journalCommitted[addr + i]);
+	uint8_t trailer[JOURNAL_CRCLEN];
+	trailer[0] = crc >> 8;
+	trailer[1] = crc;
+
+	// Writes CRC last so an interrupted write is never accepted as a record
+	verbaleyes_flash_write(at, header, JOURNAL_HEADERLEN);
+	verbaleyes_flash_write(at + JOURNAL_HEADERLEN, (const uint8_t*)journalCommitted + addr, len);
+	verbaleyes_flash_write(at + JOURNAL_HEADERLEN + len, trailer, JOURNAL_CRCLEN);
+}
+
+// Erases a sector unless it is already erased
+static void journalErase(const uint8_t sector) {
+	uint8_t chunk[JOURNAL_CHUNKLEN];
+	const uint32_t start = (uint32_t)sector * VERBALEYES_JOURNAL_SECTORSIZE;
+	for (uint32_t i = 0; i < VERBALEYES_JOURNAL_SECTORSIZE; i += JOURNAL_CHUNKLEN) {
+		const uint16_t chunkLen = (VERBALEYES_JOURNAL_SECTORSIZE - i > JOURNAL_CHUNKLEN) ? JOURNAL_CHUNKLEN : VERBALEYES_JOURNAL_SECTORSIZE - i;
+		verbaleyes_flash_read(start + i, chunk, chunkLen);
+		for (uint16_t j = 0; j < chunkLen; j++) {
+			if (chunk[j] == JOURNAL_ERASED) continue;
+			verbaleyes_flash_erase(start);
+			return;
+		}
+	}
+}
+
+// Writes a snapshot of the entire configuration to the next sector and makes it the active sector
+// The previous sector is left intact until it is erased, so an interrupted compaction falls back to it on mount
+static void journalCompact() {
+	const uint8_t sector = journalNextSector();
+	if (!journalSpareErased) journalErase(sector);
+	journalAppend((uint32_t)sector * VERBALEYES_JOURNAL_SECTORSIZE, 0, VERBALEYES_CONFIGLEN);
+	journalSector = sector;
+	journalPos = JOURNAL_SNAPSHOTLEN;
+	journalSpareErased = false;
+}
+
+
+
+// Loads configuration from the newest valid snapshot and replays the records written after it
+static void journalLoad() {
+	struct journalRecord record;
+	journalMounted = true;
+	journalSector = JOURNAL_NOSECTOR;
+	journalSeq = 0;
+	journalSpareErased = false;
+	memset(journalImage, 0, VERBALEYES_CONFIGLEN);
+
+	// Finds sector with the newest valid snapshot, only the newest has its CRC checked unless it is broken
+	uint32_t seqBelow = 0xFFFFFFFF;
+	while (journalSector == JOURNAL_NOSECTOR) {
+		uint8_t newest = JOURNAL_NOSECTOR;
+		uint32_t newestSeq = 0;
+		for (uint8_t i = 0; i < VERBALEYES_JOURNAL_SECTORS; i++) {
+			if (journalReadHeader((uint32_t)i * VERBALEYES_JOURNAL_SECTORSIZE, &record) != JOURNAL_MAGIC) continue;
+			if (record.addr != 0 || record.len != VERBALEYES_CONFIGLEN) continue;
+			if (record.seq >= seqBelow || (newest != JOURNAL_NOSECTOR && record.seq <= newestSeq)) continue;
+			newest = i;
+			newestSeq = record.seq;
+		}
+		if (newest == JOURNAL_NOSECTOR) break;
+
+		// Falls back to older snapshots if newest was interrupted
+		record.addr = 0;
+		record.len = VERBALEYES_CONFIGLEN;
+		record.seq = newestSeq;
+		if (journalCheckRecord((uint32_t)newest * VERBALEYES_JOURNAL_SECTORSIZE, &record)) {
+			journalSector = newest;
+			journalSeq = newestSeq;
+		}
+		seqBelow = newestSeq;
+	}
+
+	// Uses empty configuration if no snapshot was found
+	if (journalSector == JOURNAL_NOSECTOR) {
+		journalPos = 0;
+		return;
+	}
+
+	// Loads snapshot
+	const uint32_t start = (uint32_t)journalSector * VERBALEYES_JOURNAL_SECTORSIZE;
+	verbaleyes_flash_read(start + JOURNAL_HEADERLEN, (uint8_t*)journalImage, VERBALEYES_CONFIGLEN);
+
+	// Replays records in the active sector until erased flash is reached
+	journalPos = JOURNAL_SNAPSHOTLEN;
+	while (journalPos + JOURNAL_HEADERLEN <= VERBALEYES_JOURNAL_SECTORSIZE) {
+		const uint8_t magic = journalReadHeader(start + journalPos, &record);
+		if (magic == JOURNAL_ERASED) return;
+
+		// Stops at interrupted or broken record, next commit has to compact since this sector can not be appended to
+		if (
+			magic != JOURNAL_MAGIC ||
+			record.seq != journalSeq + 1 ||
+			journalPos + journalRecordSize(record.len) > VERBALEYES_JOURNAL_SECTORSIZE ||
+			!journalCheckRecord(start + journalPos, &record)
+		) {
+			journalPos = VERBALEYES_JOURNAL_SECTORSIZE;
+			return;
+		}
+
+		// Applies record
+		verbaleyes_flash_read(start + journalPos + JOURNAL_HEADERLEN, (uint8_t*)journalImage + record.addr, record.len);
+		journalSeq = record.seq;
+		journalPos += journalRecordSize(record.len);
+	}
+}
+
+// Loads configuration from flash, discarding everything that was not committed
+void verbaleyes_journal_mount() {
+	journalLoad();
+	memcpy(journalCommitted, journalImage, VERBALEYES_CONFIGLEN);
+}
+
+// Prepares next sector ahead of time so commits only have to append
+void verbaleyes_journal_poll() {
+	if (!journalMounted) verbaleyes_journal_mount();
+
+	// Erases the oldest sector, only one slow operation is done per call
+	if (!journalSpareErased) {
+		journalErase(journalNextSector());
+		journalSpareErased = true;
+		return;
+	}
+
+	// Compacts before a commit would have to
+	if (
+		journalSector != JOURNAL_NOSECTOR &&
+		journalPos > JOURNAL_SNAPSHOTLEN &&
+		VERBALEYES_JOURNAL_SECTORSIZE - journalPos < JOURNAL_RESERVE
+	) {
+		journalCompact();
+	}
+}
+
+
+
+// Reads configuration from RAM
+char verbaleyes_conf_read(const uint16_t addr) {
+	if (!journalMounted) verbaleyes_journal_mount();
+	return journalImage[addr];
+}
+
+// Writes configuration to RAM, it is not persistent until committed
+void verbaleyes_conf_write(const uint16_t addr, const char c) {
+	if (!journalMounted) verbaleyes_journal_mount();
+	journalImage[addr] = c;
+}
+
+// Appends changed range to the journal, or compacts into the next sector if it does not fit
+// Erasing is done in its own step to not block the caller for both erase and write
+int8_t verbaleyes_conf_commit(const uint16_t addr, const uint16_t len) {
+	if (!journalMounted) verbaleyes_journal_mount();
+	memcpy(journalCommitted + addr, journalImage + addr, len);
+	if (journalSector == JOURNAL_NOSECTOR || journalPos + journalRecordSize(len) > VERBALEYES_JOURNAL_SECTORSIZE) {
+		if (!journalSpareErased) {
+			journalErase(journalNextSector());
+			journalSpareErased = true;
+			return VERBALEYES_COMMIT_WORKING;
+		}
+		journalCompact();
+		return VERBALEYES_COMMIT_DONE;
+	}
+	journalAppend((uint32_t)journalSector * VERBALEYES_JOURNAL_SECTORSIZE + journalPos, addr, len);
+	journalPos += journalRecordSize(len);
+	return VERBALEYES_COMMIT_DONE;
+}
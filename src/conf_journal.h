@@ -0,0 +1,37 @@
+#include <stdbool.h> // bool
+#include <stdint.h> // uint8_t, uint16_t, uint32_t
+
+// Include Guard
+#ifndef VERBALEYES_CONF_JOURNAL_H
+#define VERBALEYES_CONF_JOURNAL_H
+
+// Size of one erasable flash sector
+#ifndef VERBALEYES_JOURNAL_SECTORSIZE
+#define VERBALEYES_JOURNAL_SECTORSIZE 4096
+#endif
+
+// Number of sectors the journal is spread across, at least 2 are required
+#ifndef VERBALEYES_JOURNAL_SECTORS
+#define VERBALEYES_JOURNAL_SECTORS 4
+#endif
+
+// Makes functions work in C++
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Prototypes for functions used to interact with the journal
+void verbaleyes_journal_mount();
+void verbaleyes_journal_poll();
+
+// Access to flash region used by the journal, addresses are relative to the start of the region
+extern void verbaleyes_flash_read(const uint32_t, uint8_t*, const uint16_t);
+extern void verbaleyes_flash_write(const uint32_t, const uint8_t*, const uint16_t);
+extern void verbaleyes_flash_erase(const uint32_t);
+
+// Ends extern c block
+#ifdef __cplusplus
+}
+#endif
+
+#endif // Ends include Guard
@@ -1,10 +1,9 @@
 #include <stdbool.h> // bool
-#include <stdint.h> // int8_t, uint8_t, int16_t, uint16_t, int32_t
-#include <string.h> // strcpy, memset, size_t, NULL
-#include <time.h> // time, clock, time_t, size_t, NULL
-#include <ctype.h> // tolower
-#include <stdlib.h> // realloc, free, rand, srand, size_t, NULL
-#include <stdio.h> // sprintf, vsnprintf, EOF, size_t, NULL
+#include <stdint.h> // int8_t, uint8_t, int16_t, uint16_t, int32_t, uint64_t
+#include <string.h> // strcpy, strcmp, memcpy, size_t, NULL
+#include <ctype.h> // tolower, isgraph
+#include <stdlib.h> // size_t, NULL
+#include <stdio.h> // sprintf, snprintf, vsnprintf, EOF, size_t, NULL
 #include <stdarg.h> // va_list, va_start, va_end
 
 #include <bearssl/bearssl_hash.h> // sha1
@@ -16,36 +15,135 @@
 // Initial buffer size for logging
 #define LOGBUFFERLEN 196
 
-// Number of seconds before unfinished configuration input times out
+// Number of milliseconds before unfinished configuration input times out
 #ifndef CONFIGTIMEOUT
-#define CONFIGTIMEOUT 60
+#define CONFIGTIMEOUT 60000
 #endif
 
-// Number of seconds before unsuccessful connection times out
+// Number of milliseconds before unsuccessful connection times out
 #ifndef CONNECTINGTIMEOUT
-#define CONNECTINGTIMEOUT 10
+#define CONNECTINGTIMEOUT 10000
 #endif
 
-// Number of seconds to delay retrying after connection has failed
+// Number of milliseconds to delay retrying after connection has failed, doubled for every consecutive failure
 #ifndef CONNECTIONFAILEDDELAY
-#define CONNECTIONFAILEDDELAY 5
+#define CONNECTIONFAILEDDELAY 5000
 #endif
 
+// Maximum number of milliseconds to delay retrying after consecutive connection failures
+#ifndef CONNECTIONFAILEDMAXDELAY
+#define CONNECTIONFAILEDMAXDELAY 120000
+#endif
+
+// Number of milliseconds to delay retrying after authentication has failed, retrying does not fix bad credentials
+#ifndef AUTHFAILEDDELAY
+#define AUTHFAILEDDELAY 300000
+#endif
+
+// Sends authentication together with the WebSocket upgrade request to save a round trip when connecting
+#ifndef PIPELINEDHANDSHAKE
+#define PIPELINEDHANDSHAKE false
+#endif
+
+// Number of successful sequential handshakes after a rejected pipelined one before pipelining is tried again
+#ifndef PIPELINERETRY
+#define PIPELINERETRY 10
+#endif
+
+// Number of milliseconds without receiving anything from the server before sending a ping
+#ifndef PINGINTERVAL
+#define PINGINTERVAL 5000
+#endif
+
+// Number of milliseconds without receiving anything from the server before reconnecting
+#ifndef IDLETIMEOUT
+#define IDLETIMEOUT 10000
+#endif
+
+// Number of messages that can be sent back to back before the configured message rate limit applies
+#ifndef SENDRATEBURST
+#define SENDRATEBURST 2
+#endif
+
+// Number of milliseconds between every dot in progress bars
+#define PROGRESSBARINTERVAL 1000
+
 static uint8_t state = 0;
-static time_t timeout = 0;
+static uint32_t timeout = 0;
+static uint32_t progressBarNext = 0;
+
+// Checks if a point in time has been reached, works when the millisecond counter wraps around
+static bool timeReached(const uint32_t at) {
+	return (int32_t)(verbaleyes_millis() - at) >= 0;
+}
+
+// Sets timeout a number of milliseconds from now, a progress bar started after this prints its first dot right away
+static void setTimeout(const uint32_t ms) {
+	const uint32_t now = verbaleyes_millis();
+	timeout = now + ms;
+	progressBarNext = now;
+}
+
+
 
+// State of the xorshift random number generator, it is never 0 once seeded
+static uint32_t randomState = 0;
+
+// Seeds random number generator, the seed is scrambled first since seeds like timers only differ in a few low bits
+static void randomSeed(uint32_t seed) {
+	seed ^= seed >> 16;
+	seed *= 0x7FEB352D;
+	seed ^= seed >> 15;
+	seed *= 0x846CA68B;
+	seed ^= seed >> 16;
+	randomState = (seed) ? seed : 1;
+}
+
+// Gets 32 random bits, seeds itself if it is used before a connection is made
+static uint32_t randomNext() {
+	if (randomState == 0) randomSeed(verbaleyes_seed());
+	randomState ^= randomState << 13;
+	randomState ^= randomState >> 17;
+	randomState ^= randomState << 5;
+	return randomState;
+}
 
 
+
+// Buffer for characters logged one at a time
+static char logCharBuffer[LOGBUFFERLEN];
+static uint8_t logCharLen = 0;
+
+// Prints all characters buffered by logchar
+static void logflush() {
+	if (logCharLen == 0) return;
+	logCharBuffer[logCharLen] = '\0';
+	verbaleyes_log(logCharBuffer, logCharLen);
+	logCharLen = 0;
+}
+
+// Buffers a single character to print without formatting it
+static void logchar(const char c) {
+	// Null bytes would terminate the log message early
+	if (c == '\0') return;
+
+	// Buffers character and prints buffer if full
+	logCharBuffer[logCharLen++] = c;
+	if (logCharLen == LOGBUFFERLEN - 1) logflush();
+}
+
 // Prints a string to the serial output with ability to format
 static void logprintf(const char* format, ...) {
+	// Prints buffered characters before this message to keep the order
+	logflush();
+
 	// Initializes variadic function
 	va_list args;
 	va_start(args, format);
 
-	// Formats arguments into buffer
-	char buffer[LOGBUFFERLEN];
-	const uint8_t len = vsnprintf(buffer, LOGBUFFERLEN, format, args);
-	verbaleyes_log(buffer, len);
+	// Formats arguments into the log buffer, which is empty after being flushed
+	const uint8_t len = vsnprintf(logCharBuffer, LOGBUFFERLEN, format, args);
+	verbaleyes_log(logCharBuffer, len);
 
 	// Cleans up variadic function
 	va_end(args);
@@ -53,33 +151,105 @@ static void logprintf(const char* format, ...) {
 
 // Prints progress bar every second to indicate a process is working and handle timeout errors
 static bool showProgressBar() {
-	static time_t previous;
-	const time_t current = time(NULL);
+	const uint32_t current = verbaleyes_millis();
 
 	// Handles timeout error
-	if (current > timeout) return false;
+	if ((int32_t)(current - timeout) > 0) return false;
 
-	// Prints progress bar every second
-	if (previous == current) return true;
-	previous = current;
+	// Prints progress bar every second at a steady pace, dots missed by slow callers are skipped
+	if ((int32_t)(current - progressBarNext) < 0) return true;
+	progressBarNext += PROGRESSBARINTERVAL;
+	if ((int32_t)(current - progressBarNext) >= 0) progressBarNext = current + PROGRESSBARINTERVAL;
 	logprintf(".");
 	return true;
 }
 
+// Number of consecutive connection failures since last successful authentication
+static uint8_t connectionFailures = 0;
+
+// Shortens a retry delay by a random amount of up to half of it
+// Jitter spreads out retries from devices that failed at the same time, like when a shared network goes down
+static uint32_t retryJitter(const uint32_t delay) {
+	return delay - randomNext() % (delay / 2 + 1);
+}
+
+// Gets delay before retrying with exponential backoff
+static uint32_t connectionBackoff() {
+	uint32_t delay = CONNECTIONFAILEDMAXDELAY;
+	if (connectionFailures < 16 && ((uint32_t)CONNECTIONFAILEDDELAY << connectionFailures) < CONNECTIONFAILEDMAXDELAY) {
+		delay = (uint32_t)CONNECTIONFAILEDDELAY << connectionFailures;
+	}
+	if (connectionFailures < 0xFF) connectionFailures++;
+	return retryJitter(delay);
+}
+
+// Number of sequential handshakes left before pipelining again and if the current handshake is pipelined
+static uint8_t pipelineSkip = 0;
+static bool pipelineAttempt = false;
+
 // Resets state back with an error message
 static int8_t connectionFailToState(const char* msg, const uint8_t backToState) {
+	pipelineAttempt = false;
 	logprintf(msg);
-	timeout = time(NULL) + CONNECTIONFAILEDDELAY;
+	setTimeout(connectionBackoff());
 	state = backToState;
 	return VERBALEYES_INIT_ERROR;
 }
 
+// Reconnects with an error message when the server rejected the handshake
+// Only a rejection falls back from pipelining, transport failures like a closed socket retry it pipelined
+static int8_t connectionRejected(const char* msg) {
+	if (pipelineAttempt) pipelineSkip = PIPELINERETRY;
+	return connectionFailToState(msg, 0x90);
+}
+
+// Uses byte reads for platforms not defining verbaleyes_socket_read_buf, needs weak symbols to be optional
+#if defined __has_attribute
+	#if __has_attribute (weak)
+		#define SOCKETREADBUF_WEAK
+	#endif
+#endif
+#ifdef SOCKETREADBUF_WEAK
+__attribute__((weak)) size_t verbaleyes_socket_read_buf(uint8_t* buf, const size_t len) {
+#else
+#define verbaleyes_socket_read_buf socketReadBytes
+static size_t socketReadBytes(uint8_t* buf, const size_t len) {
+#endif
+	size_t i = 0;
+	for (int16_t c; i < len && (c = verbaleyes_socket_read()) != EOF; i++) buf[i] = c;
+	return i;
+}
+
+// Buffer for reading socket data in blocks, at most 255 bytes
+#ifndef SOCKETBUFFERLEN
+#define SOCKETBUFFERLEN 64
+#endif
+static uint8_t socketBuffer[SOCKETBUFFERLEN];
+static uint8_t socketBufferIndex = 0;
+static uint8_t socketBufferLen = 0;
+
+// Gets next byte from socket, refilling buffer with everything available when it runs empty
+static int16_t socketRead() {
+	if (socketBufferIndex == socketBufferLen) {
+		socketBufferIndex = 0;
+		socketBufferLen = verbaleyes_socket_read_buf(socketBuffer, SOCKETBUFFERLEN);
+		if (socketBufferLen == 0) return EOF;
+	}
+	return socketBuffer[socketBufferIndex++];
+}
+
+// Discards all buffered and pending socket data
+static void socketFlush() {
+	socketBufferIndex = 0;
+	while ((socketBufferLen = verbaleyes_socket_read_buf(socketBuffer, SOCKETBUFFERLEN)));
+}
+
 // Reconnects to socket if unable to get data before timeout
 static int8_t socketHadNoData() {
 	if (verbaleyes_socket_connected() != VERBALEYES_CONNECT_SUCCESS) {
 		return connectionFailToState("\r\nConnection to host closed", 0x90);
 	}
-	if (time(NULL) < timeout) return VERBALEYES_INIT_WORKING;
+	if (!timeReached(timeout)) return VERBALEYES_INIT_WORKING;
 	return connectionFailToState("\r\nResponse from server ended prematurely", 0x90);
 }
 
@@ -89,59 +259,139 @@ static int8_t socketHadNoDataProgressBar() {
 		return connectionFailToState("\r\nConnection to host closed", 0x90);
 	}
 	if (showProgressBar()) return VERBALEYES_INIT_WORKING;
+
+	// A server that does not support pipelining never replies to the authentication sent with the upgrade request
+	if (state == 0x17) return connectionRejected("\r\nDid not get a response from the server");
 	return connectionFailToState("\r\nDid not get a response from the server", 0x90);
 }
 
 
 
-// Indication that a match has already succeeded
-#define SUCCESSFULMATCH 0xff
-
-// Matches incoming data character by character
-static void matchStr(uint8_t* index, const char c, const char* match) {
-	if (*index == SUCCESSFULMATCH) return;
-	if (match[*index] == '\0') *index = SUCCESSFULMATCH;
-	else if (c == match[*index]) *index += 1;
-	else *index = 0;
+// HTTP headers validated in the WebSocket handshake, sorted to be narrowed down one character at a time
+#define HEADER_CONNECTION 0
+#define HEADER_ACCEPT 1
+#define HEADER_EXTENSIONS 2
+#define HEADER_PROTOCOL 3
+#define HEADER_UPGRADE 4
+static const char* const headerNames[] = {
+	"connection",
+	"sec-websocket-accept",
+	"sec-websocket-extensions",
+	"sec-websocket-protocol",
+	"upgrade"
+};
+#define HEADERNAMESLEN (sizeof headerNames / sizeof headerNames[0])
+
+// Parts of a header line
+#define HEADERPHASE_NAME 0
+#define HEADERPHASE_VALUE 1
+#define HEADERPHASE_SKIP 2
+#define HEADERPHASE_DONE 3
+
+// Indication that a header value did not match
+#define HEADERVALUE_MISMATCH 0xff
+
+// State for parsing HTTP headers one character at a time
+static struct {
+	uint8_t phase;
+	uint8_t start;
+	uint8_t end;
+	uint8_t index;
+	bool trailingSpace;
+	uint8_t found;
+	const char* accept;
+} header;
+
+// Sets up to parse HTTP headers, accept is the expected value of the WebSocket accept header
+static void headerStart(const char* accept) {
+	header.phase = HEADERPHASE_NAME;
+	header.start = 0;
+	header.end = HEADERNAMESLEN;
+	header.index = 0;
+	header.found = 0;
+	header.accept = accept;
 }
 
+// Gets the value required for the header being parsed
+static const char* headerValue() {
+	if (header.start == HEADER_CONNECTION) return "upgrade";
+	if (header.start == HEADER_UPGRADE) return "websocket";
+	return header.accept;
+}
 
+// Checks if the header value received so far is an entire match
+static void headerValueEnd() {
+	if (header.index != HEADERVALUE_MISMATCH && headerValue()[header.index] == '\0') header.found |= 1 << header.start;
+	header.index = 0;
+	header.trailingSpace = false;
+}
 
-#define WS_PAYLOADLEN_NOTSET 1
-#define WS_PAYLOADLEN_EXTENDED 126
-#define WS_HEADERLEN (2 + 4)
-#define WS_MASKBIT 0x80
-#define WS_TEXTFRAME 0x81
-
-// Sends a string in a WebSocket frame to the server
-static void writeWebSocketFrame(const char* format, ...) {
-	// Initializes variadic function
-	va_list args;
-	va_start(args, format);
-
-	// Creates WebSocket frame for non extended lengt frame with initialized fin bit, rsv bits and opcode
-	uint8_t frame[WS_HEADERLEN + WS_PAYLOADLEN_EXTENDED] = { WS_TEXTFRAME };
-
-	// Sets payload and payload length for websocket frame
-	const uint8_t payloadLen = vsnprintf((char*)frame + WS_HEADERLEN, WS_PAYLOADLEN_EXTENDED, format, args);
-	frame[1] = WS_MASKBIT | payloadLen;
-
-	// Generates mask
-	frame[2] = rand() % 256;
-	frame[3] = rand() % 256;
-	frame[4] = rand() % 256;
-	frame[5] = rand() % 256;
-
-	// Masks payload
-	for (uint8_t i = 0; i < payloadLen; i++) {
-		frame[WS_HEADERLEN + i] ^= frame[(i & 3) + 2];
+// Parses HTTP headers in a single pass without caring about case of names or whitespace around values
+// Characters are cast to unsigned before tolower since bytes above 0x7F are negative as char
+static void headerParse(const char c) {
+	// Ignores everything after the end of the head
+	if (header.phase == HEADERPHASE_DONE) return;
+
+	// Line feed ends header line and carriage return is ignored to also handle bare line feeds
+	if (c == '\r') return;
+	if (c == '\n') {
+		if (header.phase == HEADERPHASE_NAME && header.index == 0) {
+			header.phase = HEADERPHASE_DONE;
+			return;
+		}
+		if (header.phase == HEADERPHASE_VALUE) headerValueEnd();
+		header.phase = HEADERPHASE_NAME;
+		header.start = 0;
+		header.end = HEADERNAMESLEN;
+		header.index = 0;
+		return;
 	}
 
-	// Sends websocket frame
-	verbaleyes_socket_write(frame, WS_HEADERLEN + payloadLen);
-
-	// Cleans up variadic function
-	va_end(args);
+	switch (header.phase) {
+		// Narrows down range of header names matching the name received so far
+		case HEADERPHASE_NAME: {
+			if (c == ':') {
+				if (header.start < header.end && headerNames[header.start][header.index] == '\0') {
+					header.phase = HEADERPHASE_VALUE;
+					header.index = 0;
+					header.trailingSpace = false;
+
+					// WebSocket extensions and protocols are never requested, so it is an error for them to exist at all
+					if (header.start == HEADER_EXTENSIONS || header.start == HEADER_PROTOCOL) header.found |= 1 << header.start;
+				}
+				else {
+					header.phase = HEADERPHASE_SKIP;
+				}
+				return;
+			}
+			const char lowerc = tolower((uint8_t)c);
+			while (header.start < header.end && headerNames[header.start][header.index] < lowerc) header.start++;
+			while (header.start < header.end && headerNames[header.end - 1][header.index] > lowerc) header.end--;
+			if (header.start == header.end) header.phase = HEADERPHASE_SKIP;
+			header.index++;
+			return;
+		}
+		// Matches header value, the connection header can have a list of values
+		case HEADERPHASE_VALUE: {
+			if (header.start == HEADER_EXTENSIONS || header.start == HEADER_PROTOCOL) return;
+			if (c == ' ' || c == '\t') {
+				if (header.index) header.trailingSpace = true;
+				return;
+			}
+			if (c == ',' && header.start == HEADER_CONNECTION) {
+				headerValueEnd();
+				return;
+			}
+			const char cmp = (header.start == HEADER_ACCEPT) ? c : tolower((uint8_t)c);
+			if (header.index == HEADERVALUE_MISMATCH || header.trailingSpace || headerValue()[header.index] != cmp) {
+				header.index = HEADERVALUE_MISMATCH;
+			}
+			else {
+				header.index++;
+			}
+			return;
+		}
+	}
 }
 
 
@@ -168,6 +418,16 @@ static void writeWebSocketFrame(const char* format, ...) {
 #define CONF_ADDR_CALLOW        (CONF_ADDR_DEADZONE + 2)
 #define CONF_ADDR_CALHIGH       (CONF_ADDR_CALLOW + 2)
 #define CONF_ADDR_SENS          (CONF_ADDR_CALHIGH + 2)
+#define CONF_ADDR_PROJ2         (CONF_ADDR_SENS + 2)
+#define CONF_ADDR_PROJKEY2      (CONF_ADDR_PROJ2 + CONF_LEN_PROJ)
+#define CONF_ADDR_PROJ3         (CONF_ADDR_PROJKEY2 + CONF_LEN_PROJKEY)
+#define CONF_ADDR_PROJKEY3      (CONF_ADDR_PROJ3 + CONF_LEN_PROJ)
+#define CONF_ADDR_PROJ4         (CONF_ADDR_PROJKEY3 + CONF_LEN_PROJKEY)
+#define CONF_ADDR_PROJKEY4      (CONF_ADDR_PROJ4 + CONF_LEN_PROJ)
+#define CONF_ADDR_MAXRATE       (CONF_ADDR_PROJKEY4 + CONF_LEN_PROJKEY)
+
+// Number of projects that can be controlled at the same time, additional projects are stored after the original items
+#define CONF_PROJECTS 4
 
 
 
@@ -187,49 +447,380 @@ static uint16_t confGetInt(const uint16_t addr) {
 
 
 
+// Configuration decoded from persistent storage, only updated when an item is changed
+static struct {
+	char ssid[CONF_LEN_SSID + 1];
+	char ssidkey[CONF_LEN_SSIDKEY + 1];
+	char host[CONF_LEN_HOST + 1];
+	uint16_t port;
+	char path[CONF_LEN_PATH + 1];
+	char proj[CONF_PROJECTS][CONF_LEN_PROJ + 1];
+	char projkey[CONF_PROJECTS][CONF_LEN_PROJKEY + 1];
+	uint16_t speedmin;
+	uint16_t speedmax;
+	uint16_t deadzone;
+	uint16_t callow;
+	uint16_t calhigh;
+	uint16_t sensitivity;
+	uint16_t maxrate;
+} conf;
+
 // Structure used to read and write configurable data
 // Length of 0 indicates it is a 16bit unsigned integer, -1 indicates 16bit signed integer
 struct confItem {
 	const char* name; // Name used for configuration
 	const int8_t len; // Maxumum length for item
 	const uint16_t addr; // Start address in percistent storage
+	const uint8_t keepState; // Highest state that does not have to go back when item is updated
 	const uint8_t resetState; // State to go back to when item is updated
-	uint8_t nameMatchFailed; // Internally used by configuration parser
+	const uint8_t speedFlags; // Speed mapping values that have to be recalculated when item is updated
+	void* const value; // Decoded value in conf, a char array for strings and uint16_t for integers
 };
 
+// Flags for speed mapping values that have to be recalculated
+#define SPEEDMAPPING 0x01
+#define SPEEDJITTER 0x02
+#define SPEEDRATE 0x04
+
 // Array of all configurable properties
-static struct confItem confItems[] = {
-	{ "ssid",           CONF_LEN_SSID,        CONF_ADDR_SSID,         0x00 },
-	{ "ssidkey",        CONF_LEN_SSIDKEY,     CONF_ADDR_SSIDKEY,      0x00 },
-	{ "host",           CONF_LEN_HOST,        CONF_ADDR_HOST,         0x10 },
-	{ "port",           0,                    CONF_ADDR_PORT,         0x10 },
-	{ "path",           CONF_LEN_PATH,        CONF_ADDR_PATH,         0x10 },
-	{ "proj",           CONF_LEN_PROJ,        CONF_ADDR_PROJ,         0x10 },
-	{ "projkey",        CONF_LEN_PROJKEY,     CONF_ADDR_PROJKEY,      0x10 },
-	{ "speedmin",       -1,                   CONF_ADDR_SPEEDMIN,     0x20 },
-	{ "speedmax",       -1,                   CONF_ADDR_SPEEDMAX,     0x20 },
-	{ "deadzone",       0,                    CONF_ADDR_DEADZONE,     0x20 },
-	{ "callow",         0,                    CONF_ADDR_CALLOW,       0x20 },
-	{ "calhigh",        0,                    CONF_ADDR_CALHIGH,      0x20 },
-	{ "sensitivity",    0,                    CONF_ADDR_SENS,         0x20 }
+// Must be sorted by name for the key matcher to work, every key prefix is then a contiguous range of items
+// Key lookup for every item is tested in test/test.c, which catches an item inserted out of order
+// Path only requires a new HTTP request, but that can not be sent on a socket that has already sent one
+static const struct confItem confItems[] = {
+	{ "calhigh",        0,                    CONF_ADDR_CALHIGH,      0x20, 0x20, SPEEDMAPPING | SPEEDJITTER,   &conf.calhigh },
+	{ "callow",         0,                    CONF_ADDR_CALLOW,       0x20, 0x20, SPEEDMAPPING | SPEEDJITTER,   &conf.callow },
+	{ "deadzone",       0,                    CONF_ADDR_DEADZONE,     0x20, 0x20, SPEEDMAPPING | SPEEDJITTER,   &conf.deadzone },
+	{ "host",           CONF_LEN_HOST,        CONF_ADDR_HOST,         0x10, 0x10, 0,                            conf.host },
+	{ "maxrate",        0,                    CONF_ADDR_MAXRATE,      0x20, 0x20, SPEEDRATE,                    &conf.maxrate },
+	{ "path",           CONF_LEN_PATH,        CONF_ADDR_PATH,         0x12, 0x10, 0,                            conf.path },
+	{ "port",           0,                    CONF_ADDR_PORT,         0x10, 0x10, 0,                            &conf.port },
+	{ "proj",           CONF_LEN_PROJ,        CONF_ADDR_PROJ,         0x10, 0x10, 0,                            conf.proj[0] },
+	{ "proj2",          CONF_LEN_PROJ,        CONF_ADDR_PROJ2,        0x10, 0x10, 0,                            conf.proj[1] },
+	{ "proj3",          CONF_LEN_PROJ,        CONF_ADDR_PROJ3,        0x10, 0x10, 0,                            conf.proj[2] },
+	{ "proj4",          CONF_LEN_PROJ,        CONF_ADDR_PROJ4,        0x10, 0x10, 0,                            conf.proj[3] },
+	{ "projkey",        CONF_LEN_PROJKEY,     CONF_ADDR_PROJKEY,      0x10, 0x10, 0,                            conf.projkey[0] },
+	{ "projkey2",       CONF_LEN_PROJKEY,     CONF_ADDR_PROJKEY2,     0x10, 0x10, 0,                            conf.projkey[1] },
+	{ "projkey3",       CONF_LEN_PROJKEY,     CONF_ADDR_PROJKEY3,     0x10, 0x10, 0,                            conf.projkey[2] },
+	{ "projkey4",       CONF_LEN_PROJKEY,     CONF_ADDR_PROJKEY4,     0x10, 0x10, 0,                            conf.projkey[3] },
+	{ "sensitivity",    0,                    CONF_ADDR_SENS,         0x20, 0x20, SPEEDJITTER,                  &conf.sensitivity },
+	{ "speedmax",       -1,                   CONF_ADDR_SPEEDMAX,     0x20, 0x20, SPEEDMAPPING | SPEEDJITTER,   &conf.speedmax },
+	{ "speedmin",       -1,                   CONF_ADDR_SPEEDMIN,     0x20, 0x20, SPEEDMAPPING | SPEEDJITTER,   &conf.speedmin },
+	{ "ssid",           CONF_LEN_SSID,        CONF_ADDR_SSID,         0x00, 0x00, 0,                            conf.ssid },
+	{ "ssidkey",        CONF_LEN_SSIDKEY,     CONF_ADDR_SSIDKEY,      0x00, 0x00, 0,                            conf.ssidkey }
 };
 
 #define CONFITEMSLEN (sizeof confItems / sizeof confItems[0])
 
+// Bit for every item in confItems that needs to be decoded again, all items are decoded on first use
+static uint32_t confStale = ~(uint32_t)0;
+
+// Decodes all items that were updated since they were last decoded
+static void confLoad() {
+	if (!confStale) return;
+	for (uint8_t i = 0; i < CONFITEMSLEN; i++) {
+		if (!(confStale & ((uint32_t)1 << i))) continue;
+		if (confItems[i].len > 0) {
+			confGetStr(confItems[i].addr, confItems[i].len, (char*)confItems[i].value);
+		}
+		else {
+			*(uint16_t*)confItems[i].value = confGetInt(confItems[i].addr);
+		}
+	}
+	confStale = 0;
+}
+
+// Length of the longest name in confItems, a longer name can never be matched
+#define CONFKEYMAXLEN 11
+
+// Range of items in confItems that matches the key received so far, indexed by number of characters received
+struct confRange {
+	uint8_t start;
+	uint8_t end;
+};
+static struct confRange confRanges[CONFKEYMAXLEN + 1] = { { 0, CONFITEMSLEN } };
+
+// Narrows down range of matching items for the next character in the key with a binary search
+static void confNarrowRange(const uint8_t index, const char c) {
+	uint8_t low = confRanges[index].start;
+	uint8_t high = confRanges[index].end;
+
+	// Finds first item with the character at index
+	while (low < high) {
+		const uint8_t mid = (low + high) / 2;
+		if ((uint8_t)confItems[mid].name[index] < (uint8_t)c) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	confRanges[index + 1].start = low;
+
+	// Finds first item after the character at index
+	high = confRanges[index].end;
+	while (low < high) {
+		const uint8_t mid = (low + high) / 2;
+		if ((uint8_t)confItems[mid].name[index] <= (uint8_t)c) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	confRanges[index + 1].end = low;
+}
+
+// Range of addresses in persistent storage that has changed since last commit
+static uint16_t confDirtyStart = VERBALEYES_CONFIGLEN;
+static uint16_t confDirtyEnd = 0;
+
+// Writes a byte to persistent storage only if it changes the stored value
+static void confWrite(const uint16_t addr, const char c) {
+	if (verbaleyes_conf_read(addr) == c) return;
+	verbaleyes_conf_write(addr, c);
+
+	// Extends range of changed addresses to include this address
+	if (addr < confDirtyStart) confDirtyStart = addr;
+	if (addr >= confDirtyEnd) confDirtyEnd = addr + 1;
+}
+
+// Indicates that persistent storage is still working on a commit and when it times out
+static bool confSaving = false;
+static uint32_t confSaveTimeout;
+
+// Indicates that input was ignored during the current commit, it is only logged once
+static bool confSavingIgnored = false;
+
+// Steps commit of changed range of persistent storage, it is called again until storage is done
+static void confCommit() {
+	// Does not write anything when nothing has changed
+	if (confDirtyStart >= confDirtyEnd) {
+		logprintf("Configuration unchanged\r\n");
+		return;
+	}
+
+	switch (verbaleyes_conf_commit(confDirtyStart, confDirtyEnd - confDirtyStart)) {
+		// Lets caller continue until next step unless storage has timed out
+		case VERBALEYES_COMMIT_WORKING: {
+			if (!confSaving) {
+				logprintf("Saving configuration\r\n");
+				confSaving = true;
+				confSaveTimeout = verbaleyes_millis() + CONFIGTIMEOUT;
+				return;
+			}
+			if (!timeReached(confSaveTimeout)) return;
+		}
+		// Keeps range dirty for next commit to retry
+		case VERBALEYES_COMMIT_FAIL: {
+			logprintf("Configuration could not be saved\r\n");
+			break;
+		}
+		// Clears range of changed addresses
+		default: {
+			logprintf("Configuration saved\r\n");
+			confDirtyStart = VERBALEYES_CONFIGLEN;
+			confDirtyEnd = 0;
+		}
+	}
+	confSaving = false;
+	confSavingIgnored = false;
+}
+
+// Speed mapping values that have to be recalculated, all are calculated on first run
+static uint8_t speedStale = SPEEDMAPPING | SPEEDJITTER | SPEEDRATE;
+
+// Pulls back state and marks decoded and derived values as stale to handle an updated configuration item
+static void confItemUpdated(const struct confItem* item) {
+	confStale |= (uint32_t)1 << (item - confItems);
+	speedStale |= item->speedFlags;
+	if (state > item->keepState) state = item->resetState;
+}
+
+// Gets the number of bytes an item uses in persistent storage
+static uint16_t confItemSize(const struct confItem* item) {
+	return (item->len > 0) ? item->len : 2;
+}
+
+
+
+// Character starting a binary configuration frame when received as the first character of a key
+#define CONFBIN_START 0x02
+
+// The only supported binary configuration format version
+#define CONFBIN_VERSION 1
+
+// Length of version and payload length header and length of CRC trailer
+#define CONFBIN_HEADERLEN 3
+#define CONFBIN_CRCLEN 2
+
+// Length of a record header with 16 bit address and 16 bit length
+#define CONFBIN_RECORDLEN 4
+
+// Maximum payload length, enough to update every item with its own record
+#define CONFBIN_MAXLEN (VERBALEYES_CONFIGLEN + CONFBIN_RECORDLEN * CONFITEMSLEN)
+
+// Status values for binary configuration parser
+#define CONFBIN_WORKING 0
+#define CONFBIN_DONE 1
+#define CONFBIN_ERROR 2
+
+// Buffer for payload of a binary configuration frame
+static uint8_t confBinBuffer[CONFBIN_MAXLEN];
+static uint8_t confBinVersion;
+static uint16_t confBinIndex;
+static uint16_t confBinLen;
+static uint16_t confBinCRC;
+static uint16_t confBinTrailer;
+
+// Updates CRC-16/CCITT-FALSE checksum with one byte
+static uint16_t crc16(uint16_t crc, const uint8_t c) {
+	crc ^= c << 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+// Validates all records in binary configuration payload before anything is written
+static bool confBinValidate() {
+	uint16_t i = 0;
+	while (i < confBinLen) {
+		if (confBinLen - i < CONFBIN_RECORDLEN) return false;
+		const uint16_t addr = (confBinBuffer[i] << 8) | confBinBuffer[i + 1];
+		const uint16_t len = (confBinBuffer[i + 2] << 8) | confBinBuffer[i + 3];
+		i += CONFBIN_RECORDLEN;
+		if (len > confBinLen - i || addr > VERBALEYES_CONFIGLEN || len > VERBALEYES_CONFIGLEN - addr) return false;
+		i += len;
+	}
+	return true;
+}
+
+// Writes all records in validated binary configuration payload to persistent storage
+static void confBinWrite() {
+	uint16_t i = 0;
+	while (i < confBinLen) {
+		const uint16_t addr = (confBinBuffer[i] << 8) | confBinBuffer[i + 1];
+		const uint16_t len = (confBinBuffer[i + 2] << 8) | confBinBuffer[i + 3];
+		i += CONFBIN_RECORDLEN;
+
+		// Writes record data
+		for (uint16_t j = 0; j < len; j++) {
+			confWrite(addr + j, confBinBuffer[i + j]);
+		}
+		i += len;
+
+		// Pulls back state for all items overlapping the record
+		for (uint8_t j = 0; j < CONFITEMSLEN; j++) {
+			if (confItems[j].addr < addr + len && addr < confItems[j].addr + confItemSize(&confItems[j])) {
+				confItemUpdated(&confItems[j]);
+			}
+		}
+	}
+}
+
+// Sets up to receive a binary configuration frame
+static void confBinStart() {
+	confBinIndex = 0;
+	confBinLen = 0;
+	confBinCRC = 0xFFFF;
+}
+
+// Handles one byte of a binary configuration frame
+static uint8_t confBinHandle(const uint8_t c) {
+	// Payload length is at the same position for all versions so the entire frame can be consumed
+	if (confBinIndex < CONFBIN_HEADERLEN) {
+		confBinCRC = crc16(confBinCRC, c);
+		if (confBinIndex == 0) {
+			confBinVersion = c;
+		}
+		else {
+			confBinLen = (confBinLen << 8) | c;
+		}
+		confBinIndex++;
+		return CONFBIN_WORKING;
+	}
+
+	// Buffers payload
+	const uint16_t payloadIndex = confBinIndex - CONFBIN_HEADERLEN;
+	confBinIndex++;
+	if (payloadIndex < confBinLen) {
+		confBinCRC = crc16(confBinCRC, c);
+		if (payloadIndex < CONFBIN_MAXLEN) confBinBuffer[payloadIndex] = c;
+		return CONFBIN_WORKING;
+	}
+
+	// Consumes CRC trailer before validating frame
+	confBinTrailer = (confBinTrailer << 8) | c;
+	if (payloadIndex < confBinLen + 1) return CONFBIN_WORKING;
+
+	// Validates entire frame before writing anything
+	if (confBinCRC != confBinTrailer) {
+		logprintf(" ] CRC did not match\r\n");
+	}
+	else if (confBinVersion != CONFBIN_VERSION) {
+		logprintf(" ] Unsupported version (%u)\r\n", confBinVersion);
+	}
+	else if (confBinLen > CONFBIN_MAXLEN) {
+		logprintf(" ] Payload too long\r\n");
+	}
+	else if (!confBinValidate()) {
+		logprintf(" ] Invalid record\r\n");
+	}
+	else {
+		confBinWrite();
+		logprintf(" ] CRC 0x%04X\r\n", confBinCRC);
+		return CONFBIN_DONE;
+	}
+	return CONFBIN_ERROR;
+}
+
 #define FLAGNONE 0
 #define FLAGACTIVE 1
 #define FLAGCOMMIT 2
 #define FLAGFAILED 4
 #define FLAGVALUE  8
 #define FLAGSIGNED 16
+#define FLAGBINARY 32
 
 // Updates a configurable property from a stream of characters
-bool verbaleyes_configure(const int16_t c) {
+static bool configure(const int16_t c) {
 	static uint8_t confMatchIndex;
 	static uint8_t confFlags = 0;
 	static uint8_t confIndex = 0;
 	static uint16_t confBuffer = 0;
 
+	// Steps commit in progress once per call, storage can not be changed while saving so input is ignored until it is done
+	if (confSaving) {
+		confCommit();
+		if (c == EOF || c == '\0') return false;
+		if (confSaving) {
+			if (!confSavingIgnored) logprintf("Configuration is still being saved, input was ignored\r\n");
+			confSavingIgnored = true;
+			return true;
+		}
+	}
+
+	// Handles binary configuration frame, all characters except EOF are data
+	if (confFlags & FLAGBINARY) {
+		if (c == EOF) {
+			if (!timeReached(timeout)) return true;
+			logprintf(" ] Timed out\r\n");
+			confFlags &= ~FLAGBINARY;
+			return configure('\n');
+		}
+
+		// Handles binary frame as a completed line
+		switch (confBinHandle(c)) {
+			case CONFBIN_DONE: {
+				confFlags |= FLAGCOMMIT;
+			}
+			case CONFBIN_ERROR: {
+				confFlags &= ~FLAGBINARY;
+			}
+		}
+		return true;
+	}
+
 	switch (c) {
 		// Finish matching key on delimiter input and setup to update value
 		case '\t':
@@ -239,19 +830,15 @@ bool verbaleyes_configure(const int16_t c) {
 				// Prevents handling failed matches
 				if (confFlags & FLAGFAILED) return true;
 
-				// Finish matching key and reset all items
-				for (int8_t i = 0; i < CONFITEMSLEN; i++) {
-					if (
-						!(confFlags & FLAGVALUE) &&
-						!confItems[i].nameMatchFailed &&
-						confItems[i].name[confIndex] == '\0'
-					) {
-						confMatchIndex = i;
-						confFlags |= FLAGVALUE;
-						logprintf(" ] is now: ");
-					}
-
-					confItems[i].nameMatchFailed = 0;
+				// Finish matching key, an exact match is always sorted first in its range
+				if (
+					confIndex <= CONFKEYMAXLEN &&
+					confRanges[confIndex].start < confRanges[confIndex].end &&
+					confItems[confRanges[confIndex].start].name[confIndex] == '\0'
+				) {
+					confMatchIndex = confRanges[confIndex].start;
+					confFlags |= FLAGVALUE;
+					logprintf(" ] is now: ");
 				}
 
 				// Prevents handling value for keys with no match
@@ -280,7 +867,7 @@ bool verbaleyes_configure(const int16_t c) {
 				// Special handling for first character in key
 				if (confIndex == 0) {
 					// Sets timeout for automatically exiting configuration mode
-					timeout = time(NULL) + CONFIGTIMEOUT;
+					setTimeout(CONFIGTIMEOUT);
 
 					// Ignores everything until next LF if first char indicates comment
 					if (c == '#') {
@@ -288,6 +875,14 @@ bool verbaleyes_configure(const int16_t c) {
 						return true;
 					}
 
+					// Handles everything up to end of frame as binary data
+					if (c == CONFBIN_START) {
+						logprintf((confFlags & FLAGACTIVE) ? "[ binary" : "\r\n[ binary");
+						confFlags |= FLAGBINARY | FLAGACTIVE;
+						confBinStart();
+						return true;
+					}
+
 					// Initializes new configuration update
 					if (confFlags & FLAGACTIVE) {
 						logprintf("[ ");
@@ -298,19 +893,12 @@ bool verbaleyes_configure(const int16_t c) {
 					}
 				}
 
-				// Invalidates keys that does not match incomming string
-				for (int8_t i = 0; i < CONFITEMSLEN; i++) {
-					if (
-						!confItems[i].nameMatchFailed &&
-						c != confItems[i].name[confIndex]
-					) {
-						confItems[i].nameMatchFailed = confIndex + 1;
-					}
-				}
+				// Narrows down keys that matches incomming string, no key is longer than max length
+				if (confIndex < CONFKEYMAXLEN) confNarrowRange(confIndex, c);
 			}
 			// Updates string value for matched key
 			else if (confIndex < confItems[confMatchIndex].len) {
-				verbaleyes_conf_write(confItems[confMatchIndex].addr + confIndex, c);
+				confWrite(confItems[confMatchIndex].addr + confIndex, c);
 			}
 			// Handles integer input for matched key
 			else if (confItems[confMatchIndex].len <= 0 ) {
@@ -378,17 +966,12 @@ bool verbaleyes_configure(const int16_t c) {
 
 			// Character was acceptable and continues reading more data
 			confIndex++;
-			logprintf("%c", c);
+			logchar(c);
 			return true;
 		}
 		// Handles backspace
 		case 0x7F: {
 			if (confIndex == 0) return true;
-			for (int8_t i = 0; i < CONFITEMSLEN; i++) {
-				if (confItems[i].nameMatchFailed == confIndex) {
-					confItems[i].nameMatchFailed = 0;
-				}
-			}
 			confIndex--;
 			logprintf((!(confFlags & FLAGVALUE) && confIndex == 0) ? "\b \b\b\b \b" : "\b \b");
 			return true;
@@ -399,16 +982,15 @@ bool verbaleyes_configure(const int16_t c) {
 			// Exit if configuration is not actively being updated
 			if (confFlags == FLAGNONE) return false;
 
-			// Commits all changed values if commit is required
+			// Commits all changed values if commit is required, scrolling can continue while storage is working
 			if (confFlags == FLAGCOMMIT) {
-				if (confFlags & FLAGCOMMIT) verbaleyes_conf_commit();
-				logprintf("Configuration saved\r\n");
 				confFlags = FLAGNONE;
+				confCommit();
 				return false;
 			}
 
 			// Continues waiting for new data until timeout is reached
-			if (time(NULL) < timeout) return true;
+			if (!timeReached(timeout)) return true;
 		}
 		// Terminates updating configurable data
 		case 0x1B:
@@ -418,7 +1000,7 @@ bool verbaleyes_configure(const int16_t c) {
 				// Terminates stored string
 				if (confItems[confMatchIndex].len > 0) {
 					if (confIndex < confItems[confMatchIndex].len) {
-						verbaleyes_conf_write(confItems[confMatchIndex].addr + confIndex, '\0');
+						confWrite(confItems[confMatchIndex].addr + confIndex, '\0');
 					}
 				}
 				// Stores 16 bit integer value
@@ -427,15 +1009,13 @@ bool verbaleyes_configure(const int16_t c) {
 					if (confFlags & FLAGSIGNED) confBuffer *= -1;
 
 					// Stores 16 bit integer for configuration item
-					verbaleyes_conf_write(confItems[confMatchIndex].addr, confBuffer >> 8);
-					verbaleyes_conf_write(confItems[confMatchIndex].addr + 1, confBuffer);
+					confWrite(confItems[confMatchIndex].addr, confBuffer >> 8);
+					confWrite(confItems[confMatchIndex].addr + 1, confBuffer);
 					confBuffer = 0;
 				}
 
 				// Pulls back state to handle updated value
-				if (state > confItems[confMatchIndex].resetState) {
-					state = confItems[confMatchIndex].resetState;
-				}
+				confItemUpdated(&confItems[confMatchIndex]);
 
 				// Resets to handle new keys
 				confFlags = FLAGCOMMIT | FLAGACTIVE;
@@ -452,9 +1032,6 @@ bool verbaleyes_configure(const int16_t c) {
 				}
 				// Handles termination before key was validated
 				else if (confIndex != 0) {
-					for (int8_t i = 0; i < CONFITEMSLEN; i++) {
-						confItems[i].nameMatchFailed = false;
-					}
 					logprintf(" ] Aborted\r\n");
 					confIndex = 0;
 				}
@@ -482,6 +1059,811 @@ bool verbaleyes_configure(const int16_t c) {
 	}
 }
 
+// Updates configurable properties from a single character
+bool verbaleyes_configure(const int16_t c) {
+	const bool active = configure(c);
+	logflush();
+	return active;
+}
+
+// Updates configurable properties from a buffer of characters
+bool verbaleyes_configure_buffer(const char* buf, const size_t len) {
+	// Handles empty buffer the same way as EOF for a single character
+	if (len == 0) return verbaleyes_configure(EOF);
+
+	// Processes every character in buffer, only the state after the last character is relevant
+	bool active = false;
+	for (size_t i = 0; i < len; i++) {
+		active = configure((uint8_t)buf[i]);
+	}
+	logflush();
+	return active;
+}
+
+
+
+// Fields extracted from JSON records sent by the server, sorted to be narrowed down one character at a time
+#define JSONFIELD_AUTH 0
+#define JSONFIELD_ID 1
+#define JSONFIELD_SCROLLOFFSET 2
+#define JSONFIELD_SCROLLSPEED 3
+#define JSONFIELD_NONE 0xff
+static const char* const jsonFields[] = {
+	"auth",
+	"id",
+	"scrollOffset",
+	"scrollSpeed"
+};
+#define JSONFIELDSLEN (sizeof jsonFields / sizeof jsonFields[0])
+
+// Parts of JSON text expected next
+#define JSONPHASE_VALUE 0
+#define JSONPHASE_ARRAYSTART 1
+#define JSONPHASE_KEY 2
+#define JSONPHASE_OBJECTSTART 3
+#define JSONPHASE_COLON 4
+#define JSONPHASE_AFTERVALUE 5
+#define JSONPHASE_STRING 6
+#define JSONPHASE_ESCAPE 7
+#define JSONPHASE_LITERAL 8
+#define JSONPHASE_NUMBER 9
+#define JSONPHASE_DONE 10
+#define JSONPHASE_INVALID 11
+
+// Types of values stored for fields
+#define JSONTYPE_NONE 0
+#define JSONTYPE_TRUE 1
+#define JSONTYPE_FALSE 2
+#define JSONTYPE_NULL 3
+#define JSONTYPE_NUMBER 4
+#define JSONTYPE_STRING 5
+
+// Values returned by jsonParse
+#define JSONPARSE_WORKING 0
+#define JSONPARSE_RECORD 1
+
+// Maximum depth of nested arrays and objects, one bit is used for every level
+#define JSONMAXDEPTH 32
+
+// Numbers are stored with two decimals and stop growing at this value to not overflow
+#define JSONNUMBERMAX 100000000
+
+// Record is an object at the top level or in an array at the top level, its fields are kept until the next record starts
+struct jsonRecord {
+	uint8_t fields;
+	char id[CONF_LEN_PROJ + 1];
+	uint8_t auth;
+	int32_t scrollSpeed;
+	int32_t scrollOffset;
+};
+
+// State for tokenizing JSON one character at a time without buffering the text
+static struct {
+	uint8_t phase;
+	uint8_t depth;
+	uint32_t objects;
+	bool key;
+	uint8_t start;
+	uint8_t end;
+	uint8_t index;
+	uint8_t field;
+	const char* literal;
+	uint8_t literalType;
+	int32_t number;
+	bool negative;
+	uint8_t decimals;
+	struct jsonRecord record;
+} json;
+
+// Sets up to tokenize a new JSON text
+static void jsonStart() {
+	json.phase = JSONPHASE_VALUE;
+	json.depth = 0;
+	json.objects = 0;
+	json.field = JSONFIELD_NONE;
+	json.record.fields = 0;
+}
+
+// Checks if the innermost array or object is a record
+static bool jsonInRecord() {
+	if (json.depth == 1) return json.objects & 1;
+	return json.depth == 2 && !(json.objects & 1) && (json.objects & 2);
+}
+
+// Stores a value if it belongs to a field of a record
+static void jsonValueEnd(const uint8_t type) {
+	const uint8_t field = json.field;
+	json.field = JSONFIELD_NONE;
+	json.phase = (json.depth) ? JSONPHASE_AFTERVALUE : JSONPHASE_DONE;
+	if (field == JSONFIELD_NONE) return;
+
+	// Numbers are stored with two decimals, the id is already copied while its characters were received
+	const int32_t number = (json.negative) ? -json.number : json.number;
+	switch (field) {
+		case JSONFIELD_AUTH: {
+			json.record.auth = type;
+			break;
+		}
+		case JSONFIELD_ID: {
+			if (type != JSONTYPE_STRING || json.index > CONF_LEN_PROJ) return;
+			json.record.id[json.index] = '\0';
+			break;
+		}
+		case JSONFIELD_SCROLLOFFSET: {
+			if (type != JSONTYPE_NUMBER) return;
+			json.record.scrollOffset = number / 100;
+			break;
+		}
+		case JSONFIELD_SCROLLSPEED: {
+			if (type != JSONTYPE_NUMBER) return;
+			json.record.scrollSpeed = number;
+			break;
+		}
+	}
+	json.record.fields |= 1 << field;
+}
+
+// Handles a character of a string, keys are matched against fields and the id is copied
+static void jsonStringChar(const char c) {
+	// Narrows down range of fields matching the key received so far
+	if (json.key) {
+		while (json.start < json.end && jsonFields[json.start][json.index] < c) json.start++;
+		while (json.start < json.end && jsonFields[json.end - 1][json.index] > c) json.end--;
+		if (json.start < json.end) json.index++;
+		return;
+	}
+
+	// Copies id and marks it as too long if it does not fit
+	if (json.field != JSONFIELD_ID || json.index > CONF_LEN_PROJ) return;
+	if (json.index < CONF_LEN_PROJ) json.record.id[json.index] = c;
+	json.index++;
+}
+
+// Tokenizes JSON text one character at a time and returns JSONPARSE_RECORD when a record has been completely received
+// Text that is not valid JSON is ignored from the first invalid character until it is restarted
+static uint8_t jsonParse(const char c) {
+	switch (json.phase) {
+		// Handles the start of a value or the end of an empty array
+		case JSONPHASE_ARRAYSTART: {
+			if (c == ']') break;
+		}
+		case JSONPHASE_VALUE: {
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') return JSONPARSE_WORKING;
+
+			// Opens a nested array or object, its content never belongs to a field
+			if (c == '[' || c == '{') {
+				if (json.depth == JSONMAXDEPTH) {
+					json.phase = JSONPHASE_INVALID;
+					return JSONPARSE_WORKING;
+				}
+				if (c == '{') {
+					json.objects |= (uint32_t)1 << json.depth;
+					json.phase = JSONPHASE_OBJECTSTART;
+				}
+				else {
+					json.objects &= ~((uint32_t)1 << json.depth);
+					json.phase = JSONPHASE_ARRAYSTART;
+				}
+				json.depth++;
+				json.field = JSONFIELD_NONE;
+				if (jsonInRecord()) json.record.fields = 0;
+				return JSONPARSE_WORKING;
+			}
+
+			// Starts a string value
+			if (c == '"') {
+				json.key = false;
+				json.index = 0;
+				json.phase = JSONPHASE_STRING;
+				return JSONPARSE_WORKING;
+			}
+
+			// Starts a number value
+			if (c == '-' || (c >= '0' && c <= '9')) {
+				json.number = 0;
+				json.negative = c == '-';
+				json.decimals = 0;
+				json.phase = JSONPHASE_NUMBER;
+				if (json.negative) return JSONPARSE_WORKING;
+				return jsonParse(c);
+			}
+
+			// Starts a literal value
+			json.index = 1;
+			json.phase = JSONPHASE_LITERAL;
+			if (c == 't') {
+				json.literal = "true";
+				json.literalType = JSONTYPE_TRUE;
+			}
+			else if (c == 'f') {
+				json.literal = "false";
+				json.literalType = JSONTYPE_FALSE;
+			}
+			else if (c == 'n') {
+				json.literal = "null";
+				json.literalType = JSONTYPE_NULL;
+			}
+			else {
+				json.phase = JSONPHASE_INVALID;
+			}
+			return JSONPARSE_WORKING;
+		}
+		// Handles the start of a key or the end of an empty object
+		case JSONPHASE_OBJECTSTART: {
+			if (c == '}') break;
+		}
+		case JSONPHASE_KEY: {
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') return JSONPARSE_WORKING;
+			if (c != '"') {
+				json.phase = JSONPHASE_INVALID;
+				return JSONPARSE_WORKING;
+			}
+
+			// Only keys of records are matched against fields
+			json.key = true;
+			json.start = 0;
+			json.end = (jsonInRecord()) ? JSONFIELDSLEN : 0;
+			json.index = 0;
+			json.phase = JSONPHASE_STRING;
+			return JSONPARSE_WORKING;
+		}
+		// Handles separator between key and value
+		case JSONPHASE_COLON: {
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') return JSONPARSE_WORKING;
+			json.phase = (c == ':') ? JSONPHASE_VALUE : JSONPHASE_INVALID;
+			return JSONPARSE_WORKING;
+		}
+		// Handles the end of a string and escaped characters
+		case JSONPHASE_STRING: {
+			if (c == '"') {
+				if (!json.key) {
+					jsonValueEnd(JSONTYPE_STRING);
+					return JSONPARSE_WORKING;
+				}
+				json.field = (json.start < json.end && jsonFields[json.start][json.index] == '\0') ? json.start : JSONFIELD_NONE;
+				json.index = 0;
+				json.phase = JSONPHASE_COLON;
+				return JSONPARSE_WORKING;
+			}
+			if (c == '\\') {
+				json.phase = JSONPHASE_ESCAPE;
+				return JSONPARSE_WORKING;
+			}
+			if ((uint8_t)c < ' ') {
+				json.phase = JSONPHASE_INVALID;
+				return JSONPARSE_WORKING;
+			}
+			jsonStringChar(c);
+			return JSONPARSE_WORKING;
+		}
+		// Handles character after a backslash, unicode escapes never match a field name or id
+		case JSONPHASE_ESCAPE: {
+			json.phase = JSONPHASE_STRING;
+			switch (c) {
+				case '"':
+				case '\\':
+				case '/': jsonStringChar(c); break;
+				case 'b': jsonStringChar('\b'); break;
+				case 'f': jsonStringChar('\f'); break;
+				case 'n': jsonStringChar('\n'); break;
+				case 'r': jsonStringChar('\r'); break;
+				case 't': jsonStringChar('\t'); break;
+				case 'u': {
+					json.end = json.start;
+					json.index = CONF_LEN_PROJ + 1;
+					break;
+				}
+				default: json.phase = JSONPHASE_INVALID;
+			}
+			return JSONPARSE_WORKING;
+		}
+		// Matches the rest of true, false or null
+		case JSONPHASE_LITERAL: {
+			if (c != json.literal[json.index]) {
+				json.phase = JSONPHASE_INVALID;
+				return JSONPARSE_WORKING;
+			}
+			if (json.literal[++json.index] == '\0') jsonValueEnd(json.literalType);
+			return JSONPARSE_WORKING;
+		}
+		// Reads number with two decimals, numbers with exponents are not stored for fields
+		case JSONPHASE_NUMBER: {
+			if (c >= '0' && c <= '9') {
+				if (json.decimals == 0) {
+					if (json.number < JSONNUMBERMAX) json.number = json.number * 10 + (c - '0') * 100;
+				}
+				else if (json.decimals < 3) {
+					json.number += (c - '0') * ((json.decimals == 1) ? 10 : 1);
+					json.decimals++;
+				}
+				return JSONPARSE_WORKING;
+			}
+			if (c == '.' && json.decimals == 0) {
+				json.decimals = 1;
+				return JSONPARSE_WORKING;
+			}
+			if (c == 'e' || c == 'E' || c == '+' || c == '-') {
+				json.field = JSONFIELD_NONE;
+				return JSONPARSE_WORKING;
+			}
+
+			// Any other character ends the number and is handled as what comes after it
+			jsonValueEnd(JSONTYPE_NUMBER);
+			return jsonParse(c);
+		}
+		// Handles separator or end of array or object
+		case JSONPHASE_AFTERVALUE: {
+			if (c == ' ' || c == '\t' || c == '\n' || c == '\r') return JSONPARSE_WORKING;
+			const bool object = json.objects & ((uint32_t)1 << (json.depth - 1));
+			if (c == ',') {
+				json.phase = (object) ? JSONPHASE_KEY : JSONPHASE_VALUE;
+				return JSONPARSE_WORKING;
+			}
+			if (c == ((object) ? '}' : ']')) break;
+			json.phase = JSONPHASE_INVALID;
+			return JSONPARSE_WORKING;
+		}
+		// Only allows whitespace after the JSON text
+		case JSONPHASE_DONE: {
+			if (c != ' ' && c != '\t' && c != '\n' && c != '\r') json.phase = JSONPHASE_INVALID;
+			return JSONPARSE_WORKING;
+		}
+		// Ignores everything after an invalid character
+		default: {
+			return JSONPARSE_WORKING;
+		}
+	}
+
+	// Closes array or object and tells caller if it was a record
+	const bool record = jsonInRecord();
+	json.depth--;
+	jsonValueEnd(JSONTYPE_NONE);
+	return (record) ? JSONPARSE_RECORD : JSONPARSE_WORKING;
+}
+
+
+
+#define WS_PAYLOADLEN_EXTENDED 126
+#define WS_HEADERLEN (2 + 4)
+#define WS_HEADERLEN_EXTENDED (2 + 2 + 4)
+#define WS_MASKBIT 0x80
+#define WS_TEXTFRAME 0x81
+#define WS_FINBIT 0x80
+#define WS_RSVBITS 0x70
+#define WS_OPCODEBITS 0x0F
+#define WS_CONTROLBIT 0x08
+#define WS_OPCODE_CONTINUATION 0x00
+#define WS_OPCODE_BINARY 0x02
+#define WS_OPCODE_CLOSE 0x08
+#define WS_OPCODE_PING 0x09
+#define WS_OPCODE_PONG 0x0A
+#define WS_CONTROLMAXLEN 125
+#define WS_CLOSE_PROTOCOLERROR "\x03\xEA"
+
+// Length of HTTP request to upgrade to the WebSocket protocol with the longest path and host
+#define HTTP_REQUESTLEN (4 + CONF_LEN_PATH + 17 + CONF_LEN_HOST + 89 + 24 + 4 + 1)
+
+// Length of the longest content after the id in an object, which is the authentication with the longest key
+#define WS_FIELDMAXLEN (10 + CONF_LEN_PROJKEY)
+
+// Length of the longest object for a project including the separator before it
+#define WS_RECORDMAXLEN (2 + 8 + CONF_LEN_PROJ + 3 + WS_FIELDMAXLEN + 1)
+
+// Length of the longest text message, an array with a speed and an offset object for every project
+#define WS_PAYLOADMAXLEN (1 + 2 * CONF_PROJECTS * WS_RECORDMAXLEN)
+
+// Scratch memory shared by steps that never need it at the same time, replaces stack and heap buffers
+// Contents are only valid until the function using it returns
+static union {
+	char request[HTTP_REQUESTLEN];
+	uint8_t frame[WS_HEADERLEN_EXTENDED + WS_PAYLOADMAXLEN + 1];
+} scratch;
+
+// Size of the outbound buffer, fits the HTTP upgrade request followed by a pipelined authentication frame
+#define SENDBUFFERLEN (HTTP_REQUESTLEN + WS_HEADERLEN_EXTENDED + WS_PAYLOADMAXLEN)
+
+// Ring buffer of data that is sent but not yet accepted by the socket
+static uint8_t sendBuffer[SENDBUFFERLEN];
+static uint16_t sendStart = 0;
+static uint16_t sendLen = 0;
+
+// Discards unsent data, used when a new socket connection is made
+static void socketSendReset() {
+	sendStart = 0;
+	sendLen = 0;
+}
+
+// Adds data to the outbound buffer, returns false and adds nothing if it does not fit
+static bool socketSend(const uint8_t* data, const uint16_t len) {
+	if (len > SENDBUFFERLEN - sendLen) return false;
+	for (uint16_t i = 0; i < len; i++) {
+		sendBuffer[(sendStart + sendLen + i) % SENDBUFFERLEN] = data[i];
+	}
+	sendLen += len;
+	return true;
+}
+
+// Masks and sends a WebSocket frame with its payload already placed after the longest header in the scratch frame
+// Returns false if the frame did not fit in the outbound buffer
+static bool sendWebSocketFrame(const uint8_t firstByte, const uint16_t payloadLen) {
+	// Places header right before the payload, payloads that do not fit in 7 bits use a 16 bit extended length
+	const uint8_t headerLen = (payloadLen < WS_PAYLOADLEN_EXTENDED) ? WS_HEADERLEN : WS_HEADERLEN_EXTENDED;
+	uint8_t* frame = scratch.frame + WS_HEADERLEN_EXTENDED - headerLen;
+	frame[0] = firstByte;
+	if (headerLen == WS_HEADERLEN) {
+		frame[1] = WS_MASKBIT | payloadLen;
+	}
+	else {
+		frame[1] = WS_MASKBIT | WS_PAYLOADLEN_EXTENDED;
+		frame[2] = payloadLen >> 8;
+		frame[3] = payloadLen & 0xFF;
+	}
+
+	// Generates mask from a single random number
+	uint8_t* mask = scratch.frame + WS_HEADERLEN_EXTENDED - 4;
+	const uint32_t bits = randomNext();
+	mask[0] = bits >> 24;
+	mask[1] = bits >> 16;
+	mask[2] = bits >> 8;
+	mask[3] = bits;
+
+	// Masks payload
+	for (uint16_t i = 0; i < payloadLen; i++) {
+		mask[4 + i] ^= mask[i & 3];
+	}
+
+	// Sends websocket frame
+	return socketSend(frame, headerLen + payloadLen);
+}
+
+// Length of the text message being built in the scratch frame
+static uint16_t wsMessageLen;
+
+// Appends formatted text to the message being built in the scratch frame, text that does not fit is cut off
+static void wsMessageAppend(const char* format, ...) {
+	// Initializes variadic function
+	va_list args;
+	va_start(args, format);
+
+	// Formats text after what has already been added
+	const int len = vsnprintf((char*)scratch.frame + WS_HEADERLEN_EXTENDED + wsMessageLen, WS_PAYLOADMAXLEN + 1 - wsMessageLen, format, args);
+	wsMessageLen = (len > WS_PAYLOADMAXLEN - wsMessageLen) ? WS_PAYLOADMAXLEN : wsMessageLen + len;
+
+	// Cleans up variadic function
+	va_end(args);
+}
+
+// Checks if a project slot is used, the first project is always used
+// Slots starting with a character that can not be part of an id are unused, erased storage reads as 0xFF and not '\0'
+static bool projectUsed(const uint8_t project) {
+	return project == 0 || isgraph((uint8_t)conf.proj[project][0]);
+}
+
+// Gets the project a received record has the id of, CONF_PROJECTS if it is not for any of them
+static uint8_t projectOfRecord() {
+	if (!(json.record.fields & (1 << JSONFIELD_ID))) return CONF_PROJECTS;
+	for (uint8_t i = 0; i < CONF_PROJECTS; i++) {
+		if (projectUsed(i) && !strcmp(json.record.id, conf.proj[i])) return i;
+	}
+	return CONF_PROJECTS;
+}
+
+// Appends an object for every project to the message being built, field is the formatted content after the id
+static void wsMessageAppendProjects(const char* field) {
+	for (uint8_t i = 0; i < CONF_PROJECTS; i++) {
+		if (!projectUsed(i)) continue;
+		wsMessageAppend("%s{\"id\": \"%s\", %s}", (wsMessageLen) ? ", " : "[", conf.proj[i], field);
+	}
+}
+
+// Sends authentication for all projects in a single message, returns false if it did not fit in the outbound buffer
+static bool writeAuthenticationFrame() {
+	wsMessageLen = 0;
+	for (uint8_t i = 0; i < CONF_PROJECTS; i++) {
+		if (!projectUsed(i)) continue;
+		wsMessageAppend("%s{\"id\": \"%s\", \"auth\": \"%s\"}", (wsMessageLen) ? ", " : "[", conf.proj[i], conf.projkey[i]);
+	}
+	wsMessageAppend("]");
+	return sendWebSocketFrame(WS_TEXTFRAME, wsMessageLen);
+}
+
+// Sends a WebSocket control frame with a binary payload, returns false if it did not fit in the outbound buffer
+static bool writeWebSocketControl(const uint8_t opcode, const uint8_t* payload, const uint8_t len) {
+	memcpy(scratch.frame + WS_HEADERLEN_EXTENDED, payload, len);
+	return sendWebSocketFrame(WS_FINBIT | opcode, len);
+}
+
+// Latest values queued to be sent in the next message, a value replaces the previous one if that has not been sent yet
+static int32_t sendSpeed;
+static bool sendSpeedPending = false;
+static bool sendOffsetPending = false;
+
+// Size of the token bucket limiting the message rate, a token is added every 1000 / maxrate milliseconds
+#define SENDRATEBUCKET ((uint32_t)SENDRATEBURST * 1000)
+
+// Tokens in the bucket scaled by 1000 to add them for every millisecond without rounding, starts full
+static uint32_t sendRateTokens = SENDRATEBUCKET;
+static uint32_t sendRateUpdatedAt;
+
+// Takes a token if the configured message rate allows sending a message now, a maxrate of 0 is unlimited
+static bool sendRateTake() {
+	if (conf.maxrate == 0) return true;
+
+	// Refills bucket for the time passed, time is capped since a longer time can not add more than a full bucket
+	const uint32_t now = verbaleyes_millis();
+	uint32_t elapsed = now - sendRateUpdatedAt;
+	sendRateUpdatedAt = now;
+	if (elapsed > SENDRATEBUCKET) elapsed = SENDRATEBUCKET;
+	sendRateTokens += elapsed * conf.maxrate;
+	if (sendRateTokens > SENDRATEBUCKET) sendRateTokens = SENDRATEBUCKET;
+
+	// Keeps values queued until a whole token is available
+	if (sendRateTokens < 1000) return false;
+	sendRateTokens -= 1000;
+	return true;
+}
+
+// Writes as much buffered data as the socket accepts without waiting, the rest is retried on the next call
+static void socketSendFlush() {
+	while (true) {
+		// Writes up to the end of the ring buffer first and then the part that wrapped around
+		while (sendLen) {
+			uint16_t chunk = SENDBUFFERLEN - sendStart;
+			if (chunk > sendLen) chunk = sendLen;
+			const size_t sent = verbaleyes_socket_write(sendBuffer + sendStart, chunk);
+			sendStart = (sendStart + sent) % SENDBUFFERLEN;
+			sendLen -= sent;
+			if (sent < chunk) return;
+		}
+
+		// Only creates a message for the latest values once everything before it is sent and the connection is ready
+		if (state != 0xFF || (!sendSpeedPending && !sendOffsetPending)) return;
+
+		// Keeps latest values queued when limited by the message rate, they are sent when the bucket has refilled
+		if (!sendRateTake()) return;
+
+		// Sends all queued values in a single message to only use one frame and keep them together on the server
+		wsMessageLen = 0;
+		if (sendSpeedPending) {
+			char field[32];
+			snprintf(field, sizeof field, "\"scrollSpeed\": %.2f", (float)sendSpeed / 100);
+			wsMessageAppendProjects(field);
+		}
+		if (sendOffsetPending) {
+			wsMessageAppendProjects("\"scrollOffset\": 0");
+		}
+		wsMessageAppend("]");
+
+		// Keeps values queued if the message does not fit, they are replaced by newer values instead of piling up
+		if (!sendWebSocketFrame(WS_TEXTFRAME, wsMessageLen)) return;
+		sendSpeedPending = false;
+		sendOffsetPending = false;
+	}
+}
+
+// Parts of an incoming WebSocket frame
+#define WSREAD_OPCODE 0
+#define WSREAD_LENGTH 1
+#define WSREAD_EXTENDEDLENGTH 2
+#define WSREAD_PAYLOAD 3
+
+// Values returned by wsReadData besides payload bytes and EOF
+#define WSREAD_MESSAGEEND (-2)
+#define WSREAD_FAILED (-3)
+
+// Incoming WebSocket frame being decoded, payloads of control frames are kept to answer them
+static struct {
+	uint8_t phase;
+	uint8_t opcode;
+	uint8_t lengthBytes;
+	uint64_t remaining;
+	bool message;
+	bool messageEnd;
+	uint8_t controlLen;
+	uint8_t control[WS_CONTROLMAXLEN];
+} wsRead;
+
+// Time of the last data received from the server and if a ping has been sent since then
+static uint32_t wsReceivedAt;
+static bool wsPingSent;
+
+// Sets up to decode frames on a new WebSocket connection
+static void wsReadStart() {
+	wsRead.phase = WSREAD_OPCODE;
+	wsRead.message = false;
+	wsRead.messageEnd = false;
+	wsReceivedAt = verbaleyes_millis();
+	wsPingSent = false;
+	jsonStart();
+}
+
+// Answers a completely received control frame
+static int8_t wsHandleControl() {
+	switch (wsRead.opcode & WS_OPCODEBITS) {
+		// Answers ping with pong containing the same payload, a pong that does not fit is dropped like a lost packet
+		case WS_OPCODE_PING: {
+			writeWebSocketControl(WS_OPCODE_PONG, wsRead.control, wsRead.controlLen);
+			return VERBALEYES_INIT_DONE;
+		}
+		// Completes close handshake by echoing the status code and reconnects, reconnecting does not depend on the echo being sent
+		case WS_OPCODE_CLOSE: {
+			writeWebSocketControl(WS_OPCODE_CLOSE, wsRead.control, (wsRead.controlLen < 2) ? wsRead.controlLen : 2);
+			return connectionFailToState("\r\nConnection closed by server", 0x90);
+		}
+	}
+	return VERBALEYES_INIT_DONE;
+}
+
+// Closes with protocol error status code and reconnects because of a WebSocket protocol error
+static int16_t wsReadFail(const char* msg) {
+	writeWebSocketControl(WS_OPCODE_CLOSE, (const uint8_t*)WS_CLOSE_PROTOCOLERROR, 2);
+	connectionFailToState(msg, 0x90);
+	return WSREAD_FAILED;
+}
+
+// Decodes incoming frames until a payload byte of a text or binary message is found, control frames are handled on the way
+// Returns the payload byte, WSREAD_MESSAGEEND after the last byte of a message, EOF if no data is available or WSREAD_FAILED
+static int16_t wsReadData() {
+	// Reports end of message after its last byte has been returned
+	if (wsRead.messageEnd) {
+		wsRead.messageEnd = false;
+		return WSREAD_MESSAGEEND;
+	}
+
+	int16_t c;
+	while ((c = socketRead()) != EOF) {
+		wsReceivedAt = verbaleyes_millis();
+		wsPingSent = false;
+
+		switch (wsRead.phase) {
+			// Gets fin bit and opcode and makes sure fragments and control frames come in a valid order
+			case WSREAD_OPCODE: {
+				const uint8_t opcode = c & WS_OPCODEBITS;
+				if (c & WS_RSVBITS) return wsReadFail("\r\nReceived a WebSocket frame using an extension that was not requested");
+				if (opcode & WS_CONTROLBIT) {
+					if (opcode > WS_OPCODE_PONG || !(c & WS_FINBIT)) return wsReadFail("\r\nReceived an invalid WebSocket control frame");
+				}
+				else if (opcode == WS_OPCODE_CONTINUATION) {
+					if (!wsRead.message) return wsReadFail("\r\nReceived a WebSocket continuation frame without a message to continue");
+				}
+				else if (opcode > WS_OPCODE_BINARY) {
+					return wsReadFail("\r\nReceived a WebSocket frame with an unknown opcode");
+				}
+				else if (wsRead.message) {
+					return wsReadFail("\r\nReceived a new WebSocket message before the previous one ended");
+				}
+				else {
+					wsRead.message = true;
+				}
+				wsRead.opcode = c;
+				wsRead.controlLen = 0;
+				wsRead.phase = WSREAD_LENGTH;
+				continue;
+			}
+			// Gets payload length or how many bytes are used for the extended payload length
+			case WSREAD_LENGTH: {
+				if (c & WS_MASKBIT) return wsReadFail("\r\nReveiced a masked frame which is not allowed");
+				wsRead.remaining = c & 0x7F;
+				if (wsRead.remaining >= WS_PAYLOADLEN_EXTENDED) {
+					wsRead.lengthBytes = (wsRead.remaining == WS_PAYLOADLEN_EXTENDED) ? 2 : 8;
+					wsRead.remaining = 0;
+					wsRead.phase = WSREAD_EXTENDEDLENGTH;
+					continue;
+				}
+				wsRead.phase = WSREAD_PAYLOAD;
+				break;
+			}
+			// Gets 16 or 64 bit extended payload length
+			case WSREAD_EXTENDEDLENGTH: {
+				wsRead.remaining = wsRead.remaining << 8 | c;
+				if (--wsRead.lengthBytes) continue;
+				wsRead.phase = WSREAD_PAYLOAD;
+				break;
+			}
+			// Keeps payload of control frames and returns payload of messages
+			case WSREAD_PAYLOAD: {
+				wsRead.remaining--;
+				if (wsRead.opcode & WS_CONTROLBIT) {
+					wsRead.control[wsRead.controlLen++] = c;
+					break;
+				}
+				if (wsRead.remaining == 0) {
+					wsRead.phase = WSREAD_OPCODE;
+					wsRead.message = !(wsRead.opcode & WS_FINBIT);
+					wsRead.messageEnd = !wsRead.message;
+				}
+				return c;
+			}
+		}
+
+		// Control frames can not be longer than what fits in one byte of payload length
+		if ((wsRead.opcode & WS_CONTROLBIT) && wsRead.controlLen + wsRead.remaining > WS_CONTROLMAXLEN) {
+			return wsReadFail("\r\nReceived an invalid WebSocket control frame");
+		}
+
+		// Handles frames where the entire payload is received
+		if (wsRead.remaining) continue;
+		wsRead.phase = WSREAD_OPCODE;
+		if (wsRead.opcode & WS_CONTROLBIT) {
+			if (wsHandleControl() != VERBALEYES_INIT_DONE) return WSREAD_FAILED;
+		}
+		else if (wsRead.opcode & WS_FINBIT) {
+			wsRead.message = false;
+			return WSREAD_MESSAGEEND;
+		}
+	}
+	return EOF;
+}
+
+// Handles everything received after authentication and detects a server that stopped responding
+static int8_t wsPoll() {
+	// Reads messages from the server and prints changes made to the projects by other clients
+	int16_t c;
+	while ((c = wsReadData()) != EOF) {
+		if (c == WSREAD_FAILED) return VERBALEYES_INIT_ERROR;
+		if (c == WSREAD_MESSAGEEND) {
+			jsonStart();
+			continue;
+		}
+		if (jsonParse(c) != JSONPARSE_RECORD) continue;
+		const uint8_t project = projectOfRecord();
+		if (project == CONF_PROJECTS) continue;
+		if (json.record.fields & (1 << JSONFIELD_SCROLLSPEED)) {
+			logprintf("\r\nSpeed of %s was updated by the server to: %.2f", conf.proj[project], (float)json.record.scrollSpeed / 100);
+		}
+		if (json.record.fields & (1 << JSONFIELD_SCROLLOFFSET)) {
+			logprintf("\r\nScroll position of %s was set by the server to: %ld", conf.proj[project], (long)json.record.scrollOffset);
+		}
+	}
+
+	// Reconnects if server does not respond to ping
+	const uint32_t idle = verbaleyes_millis() - wsReceivedAt;
+	if (idle >= IDLETIMEOUT) return connectionFailToState("\r\nServer stopped responding", 0x90);
+
+	// Pings server when it has been quiet for a while to find out if it is still there
+	// A ping that did not fit in the outbound buffer is retried on the next call
+	if (idle >= PINGINTERVAL && !wsPingSent) {
+		wsPingSent = writeWebSocketControl(WS_OPCODE_PING, (const uint8_t*)"", 0);
+	}
+	return VERBALEYES_INIT_DONE;
+}
+
+// Generates a random WebSocket key and the accept value the server has to respond with
+static void createWebSocketKey(char* key, char* accept) {
+	// Reseeds random number generator for every connection
+	randomSeed(verbaleyes_seed());
+
+	// Generates websocket key with 5 characters from every random number, the last character only has 2 random bits
+	const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	uint32_t bits = 0;
+	for (uint8_t i = 0; i < 21; i++) {
+		if (i % 5 == 0) bits = randomNext();
+		key[i] = table[bits & 0x3F];
+		bits >>= 6;
+	}
+	key[21] = table[(bits & 0x03) << 4];
+	key[22] = '=';
+	key[23] = '=';
+	key[24] = '\0';
+
+	// Creates websocket accept header value to compare against
+	br_sha1_context ctx;
+	br_sha1_init(&ctx);
+	br_sha1_update(&ctx, key, 24);
+	br_sha1_update(&ctx, "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", 36);
+	uint8_t hash[21];
+	br_sha1_out(&ctx, hash);
+	hash[20] = 0;
+	for (uint8_t i = 0; i < 21; i += 3) {
+		const uint8_t offset = i / 3;
+		accept[i + offset] = table[hash[i] >> 2];
+		accept[i + 1 + offset] = table[((hash[i] & 0x03) << 4) | hash[i + 1] >> 4];
+		accept[i + 2 + offset] = table[(hash[i + 1] & 0x0f) << 2 | hash[i + 2] >> 6];
+		accept[i + 3 + offset] = table[hash[i + 2] & 0x3f];
+	}
+	strcpy(accept + 27, "=");
+}
+
 
 
 // Global variables for mapping analog scroll input
@@ -490,23 +1872,26 @@ int32_t speedOffset;
 int32_t deadzoneSize;
 uint16_t jitterSize;
 
-// Global variable for projID to connect to
-char projID[CONF_LEN_PROJ + 1];
-
 #define RESINDEXFAILED 0xffff
 
 // Ensures everything is connected to be able to transmit speed changes to the server
-int8_t verbaleyes_initialize() {
+static int8_t initialize() {
 	static uint16_t resIndex = 0;
-	static uint8_t resMatchIndexes[5];
-	static char* buf;
+	static uint8_t authPending;
+	static uint8_t authFailed;
+	static bool authReceived;
+	static char key[24 + 1];
+	static char accept[28 + 1];
+
+	// Decodes updated configuration items
+	confLoad();
 
 	// Ensure network connection
 	switch (state) {
 		// Prevents immediately retrying after something fails
 		case 0x80:
 		case 0x90: {
-			if (time(NULL) >= timeout) state &= 0x7F;
+			if (timeReached(timeout)) state &= 0x7F;
 			return VERBALEYES_INIT_WORKING;
 		}
 		// Reconnects to network if connection is lost
@@ -516,18 +1901,12 @@ int8_t verbaleyes_initialize() {
 		}
 		// Initialize network connection
 		case 0x00: {
-			// Gets network ssid and key from config
-			char ssid[CONF_LEN_SSID + 1];
-			confGetStr(CONF_ADDR_SSID, CONF_LEN_SSID, ssid);
-			char ssidkey[CONF_LEN_SSIDKEY + 1];
-			confGetStr(CONF_ADDR_SSIDKEY, CONF_LEN_SSIDKEY, ssidkey);
-
 			// Prints
-			logprintf("\r\nConnecting to SSID: %s...", ssid);
+			logprintf("\r\nConnecting to SSID: %s...", conf.ssid);
 
 			// Connects to ssid with key
-			timeout = time(NULL) + CONNECTINGTIMEOUT;
-			verbaleyes_network_connect(ssid, ssidkey);
+			setTimeout(CONNECTINGTIMEOUT);
+			verbaleyes_network_connect(conf.ssid, conf.ssidkey);
 			state = 0x01;
 		}
 		// Completes network connection
@@ -559,18 +1938,16 @@ int8_t verbaleyes_initialize() {
 		}
 		// Initialize socket connection
 		case 0x10: {
-			// Gets host and port from config
-			buf = (char*)realloc(buf, CONF_LEN_HOST + 1);
-			if (buf == NULL) logprintf("\r\nERROR: realloc failed\r\n");
-			confGetStr(CONF_ADDR_HOST, CONF_LEN_HOST, buf);
-			const uint16_t port = confGetInt(CONF_ADDR_PORT);
-
 			// Prints
-			logprintf("\r\nConnecting to host: %s:%u...", buf, port);
+			logprintf("\r\nConnecting to host: %s:%u...", conf.host, conf.port);
 
 			// Connects to socket at host
-			timeout = time(NULL) + CONNECTINGTIMEOUT;
-			verbaleyes_socket_connect(buf, port);
+			setTimeout(CONNECTINGTIMEOUT);
+			verbaleyes_socket_connect(conf.host, conf.port);
+			socketSendReset();
+
+			// Prepares WebSocket handshake while the socket connects
+			createWebSocketKey(key, accept);
 			state = 0x11;
 		}
 		// Completes socket connection
@@ -589,70 +1966,37 @@ int8_t verbaleyes_initialize() {
 		}
 		// Sends http request to use websocket protocol
 		case 0x12: {
-			// Gets path to use on host
-			char path[CONF_LEN_PATH + 1];
-			confGetStr(CONF_ADDR_PATH, CONF_LEN_PATH, path);
-
 			// Prints
-			logprintf("\r\nAccessing WebSocket server at %s...", path);
-
-			// Sets random seed
-			srand(clock());
-
-			// Generates websocket key
-			const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-			char key[25];
-			for (uint8_t i = 0; i < 21; i++) {
-				key[i] = table[rand() % 64];
-			}
-			key[21] = table[rand() % 4 * 16];
-			key[22] = '=';
-			key[23] = '=';
-			key[24] = '\0';
+			logprintf("\r\nAccessing WebSocket server at %s...", conf.path);
 
 			// Flushes any data existing in sockets read buffer
-			while (verbaleyes_socket_read() != EOF);
+			socketFlush();
 
 			// Sends HTTP request to setup WebSocket connection with host
-			char req[4 + CONF_LEN_PATH + 17 + CONF_LEN_HOST + 89 + 24 + 4 + 1];
+			char* req = scratch.request;
 			uint8_t reqlen = sprintf(
 				req,
 				"GET %s HTTP/1.1\r\nHost: %s\r\nConnection: Upgrade\r\nUpgrade: websocket\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: %s\r\n\r\n",
-				path,
-				buf,
+				conf.path,
+				conf.host,
 				key
 			);
-			verbaleyes_socket_write((uint8_t*)req, reqlen);
-
-			// Creates websocket accept header to compare against
-			buf = (char*)realloc(buf, 22 + 28 + 2 + 1);
-			if (buf == NULL) logprintf("\r\nERROR: realloc failed\r\n");
-			strcpy(buf, "sec-websocket-accept: ");
-			br_sha1_context ctx;
-			br_sha1_init(&ctx);
-			br_sha1_update(&ctx, key, 24);
-			br_sha1_update(&ctx, "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", 36);
-			uint8_t hash[21];
-			br_sha1_out(&ctx, hash);
-			hash[20] = 0;
-			for (uint8_t i = 0; i < 21; i += 3) {
-				const uint8_t offset = i / 3;
-				buf[i + 22 + offset] = table[hash[i] >> 2];
-				buf[i + 1 + 22 + offset] = table[((hash[i] & 0x03) << 4) | hash[i + 1] >> 4];
-				buf[i + 2 + 22 + offset] = table[(hash[i + 1] & 0x0f) << 2 | hash[i + 2] >> 6];
-				buf[i + 3 + 22 + offset] = table[hash[i + 2] & 0x3f];
-			}
-			strcpy(buf + 22 + 27, "=\r\n");
+			if (!socketSend((uint8_t*)req, reqlen)) return connectionFailToState("\r\nRequest did not fit in the send buffer", 0x90);
+
+			// Sends authentication right away without waiting for the upgrade to complete
+			pipelineAttempt = PIPELINEDHANDSHAKE && pipelineSkip == 0;
+			if (pipelineAttempt && !writeAuthenticationFrame()) return connectionFailToState("\r\nAuthentication did not fit in the send buffer", 0x90);
+			socketSendFlush();
 
 			// Sets timeout value for awaiting http response
-			timeout = time(NULL) + CONNECTINGTIMEOUT;
+			setTimeout(CONNECTINGTIMEOUT);
 
 			// Sets up to read and verify http response
 			state = 0x13;
 		}
 		// Validates first HTTP status-line character
 		case 0x13: {
-			const int16_t c = verbaleyes_socket_read();
+			const int16_t c = socketRead();
 
 			// Shows progress bar until socket starts receiving data
 			if (c == EOF) return socketHadNoDataProgressBar();
@@ -665,20 +2009,22 @@ int8_t verbaleyes_initialize() {
 		// Validates HTTP status-line
 		case 0x14: {
 			while (resIndex != 12) {
-				const int16_t c = verbaleyes_socket_read();
+				const int16_t c = socketRead();
 
 				// Handles incorrect status code, timeout and socket close error
 				if (c == EOF) {
 					if (resIndex != RESINDEXFAILED) return socketHadNoData();
-					return connectionFailToState("\r\nReceived unexpected HTTP response code", 0x90);
+					return connectionRejected("\r\nReceived unexpected HTTP response code");
 				}
 
 				// Prints HTTP status-line
 				if (c == '\n') {
-					logprintf("\r\n\t");
+					logchar('\r');
+					logchar('\n');
+					logchar('\t');
 				}
 				else {
-					logprintf("%c", c);
+					logchar(c);
 				}
 
 				// Prints entire HTTP response before handling unexpected HTTP response code
@@ -695,205 +2041,204 @@ int8_t verbaleyes_initialize() {
 			}
 
 			// Successfully validated status-line and sets up to validate http headers
-			memset(resMatchIndexes, 0, sizeof resMatchIndexes);
+			headerStart(accept);
 			state = 0x15;
 		}
 		// Validates HTTP headers
 		case 0x15: {
-			// Validate headers until EOF
+			// Validate headers until end of head or EOF
 			int16_t c;
-			while ((c = verbaleyes_socket_read()) != EOF) {
-				// Analyzes HTTP headers up to end of head
-				matchStr((uint8_t*)&resIndex, c, "\r\n\r\n");
-
+			while (header.phase != HEADERPHASE_DONE && (c = socketRead()) != EOF) {
 				// Prints HTTP headers
-				if (c == '\n') {
-					logprintf("\n\t");
-				}
-				else {
-					logprintf("%c", c);
-				}
+				logchar(c);
+				if (c == '\n') logchar('\t');
 
-				// Matches the incoming HTTP response against required and illigal substrings
-				const char lowerc = tolower(c);
-				matchStr(&resMatchIndexes[0], lowerc, "connection: upgrade\r\n");
-				matchStr(&resMatchIndexes[1], lowerc, "upgrade: websocket\r\n");
-				matchStr(&resMatchIndexes[2], (resMatchIndexes[2] <= 20) ? lowerc : c, buf);
-				matchStr(&resMatchIndexes[3], lowerc, "sec-websocket-extensions: ");
-				matchStr(&resMatchIndexes[4], lowerc, "sec-websocket-protocol: ");
+				// Matches the incoming HTTP headers against required and illegal headers
+				headerParse(c);
 			}
 
 			// Handles timeout and socket close error if end of headers was not reached
-			if (resIndex < 4) return socketHadNoData();
+			if (header.phase != HEADERPHASE_DONE) return socketHadNoData();
 
 			// Requires "Connection" header with "Upgrade" value and "Upgrade" header with "websocket" value
-			if (!resMatchIndexes[0] || !resMatchIndexes[1]) {
-				return connectionFailToState("\r\nHTTP response is not an upgrade to the WebSockets protocol", 0x90);
+			if (!(header.found & (1 << HEADER_CONNECTION)) || !(header.found & (1 << HEADER_UPGRADE))) {
+				return connectionRejected("\r\nHTTP response is not an upgrade to the WebSockets protocol");
 			}
 			// Requires WebSocket accept header with correct value
-			else if (!resMatchIndexes[2]) {
-				return connectionFailToState("\r\nMissing or incorrect WebSocket accept header", 0x90);
+			else if (!(header.found & (1 << HEADER_ACCEPT))) {
+				return connectionRejected("\r\nMissing or incorrect WebSocket accept header");
 			}
 			// Checks for non-requested WebSocket extension header
-			else if (resMatchIndexes[3]) {
-				return connectionFailToState("\r\nUnexpected WebSocket Extension header", 0x90);
+			else if (header.found & (1 << HEADER_EXTENSIONS)) {
+				return connectionRejected("\r\nUnexpected WebSocket Extension header");
 			}
 			// Checks for non-requested WebSocket protocol header
-			else if (resMatchIndexes[4]) {
-				return connectionFailToState("\r\nUnexpected WebSocket Protocol header", 0x90);
+			else if (header.found & (1 << HEADER_PROTOCOL)) {
+				return connectionRejected("\r\nUnexpected WebSocket Protocol header");
 			}
 
-			// Frees up allocated buffer
-			free(buf);
-			buf = NULL;
-
 			// Successfully validated http headers
 			logprintf("\r\nWebSocket connection established");
 		}
-		// Connect to verbalEyes project
+		// Connect to verbalEyes projects
 		case 0x16: {
-			// Gets project and project key from config
-			confGetStr(CONF_ADDR_PROJ, CONF_LEN_PROJ, projID);
-			char projkey[CONF_LEN_PROJKEY + 1];
-			confGetStr(CONF_ADDR_PROJKEY, CONF_LEN_PROJKEY, projkey);
+			// Prints all projects and sets them up to wait for authentication
+			logprintf("\r\nConnecting to project: %s", conf.proj[0]);
+			authPending = 1;
+			for (uint8_t i = 1; i < CONF_PROJECTS; i++) {
+				if (!projectUsed(i)) continue;
+				logprintf(", %s", conf.proj[i]);
+				authPending |= 1 << i;
+			}
+			logprintf("...");
 
-			// Prints
-			logprintf("\r\nConnecting to project: %s...", projID);
+			// Starts decoding WebSocket frames sent by the server
+			wsReadStart();
 
-			// Sends VerbalEyes project authentication request
-			writeWebSocketFrame("[{\"id\": \"%s\", \"auth\": \"%s\"}]", projID, projkey);
+			// Sends VerbalEyes project authentication request unless it was pipelined with the upgrade request
+			if (!pipelineAttempt && !writeAuthenticationFrame()) return connectionFailToState("\r\nAuthentication did not fit in the send buffer", 0x90);
+			socketSendFlush();
 
 			// Sets timeout value for awaiting websocket response
-			timeout = time(NULL) + CONNECTINGTIMEOUT;
+			setTimeout(CONNECTINGTIMEOUT);
 
 			// Sets up to read and verify websocket response
 			resIndex = 0;
+			authFailed = CONF_PROJECTS;
+			authReceived = false;
 			state = 0x17;
 		}
-		// Validates WebSocket opcode for authentication
+		// Reads WebSocket messages up to the end of the authentication responses for all projects
 		case 0x17: {
-			const int16_t c = verbaleyes_socket_read();
-
-			// Shows progress bar until socket starts receiving data
-			if (c == EOF) return socketHadNoDataProgressBar();
-
-			// Makes sure this is an unfragmented WebSocket frame in text format
-			if (c != 0x81) {
-				return connectionFailToState("\r\nReceived response data is either not a WebSocket frame or uses an unsupported WebSocket feature", 0x90);
-			}
-
-			// Sets up to read WebSocket payload length
-			resIndex = WS_PAYLOADLEN_NOTSET;
-			state = 0x18;
-		}
-		// Gets length of WebSocket payload for authentication
-		case 0x18: {
 			while (true) {
-				const int16_t c = verbaleyes_socket_read();
-
-				// Handles timeout error
-				if (c == EOF) return socketHadNoData();
+				const int16_t c = wsReadData();
 
-				// Gets payload length and continues if extended payload length is used
-				if (resIndex == WS_PAYLOADLEN_NOTSET) {
-					// Server is not allowed to mask messages sent to the client according to the spec
-					if (c & 0x80) return connectionFailToState("\r\nReveiced a masked frame which is not allowed", 0x90);
+				// Handles timeout error and shows progress bar until a message starts
+				if (c == EOF) return (resIndex) ? socketHadNoData() : socketHadNoDataProgressBar();
+				if (c == WSREAD_FAILED) return VERBALEYES_INIT_ERROR;
 
-					// Gets payload length without mask bit
-					resIndex = c & 0x7F;
-
-					// Moves on if payload length was defined in one byte
-					if (resIndex < WS_PAYLOADLEN_EXTENDED) break;
-
-					// Aborts if payload length requires more than the 16 bits available in resIndex
-					if (resIndex == 127) return connectionFailToState("\r\nWebsocket frame was unexpectedly long", 0x90);
-				}
-				// Gets first byte of extended payload length
-				else if (resIndex == WS_PAYLOADLEN_EXTENDED) {
-					resIndex = c << 8;
+				// Prints header before the payload of every message
+				if (!resIndex) {
+					logprintf("\r\nReceived message:\r\n\t");
+					resIndex = 1;
 				}
-				// Adds second byte of extended payload length and moves on
-				else {
-					resIndex |= c;
-					break;
+
+				// Keeps reading until all projects got an authentication response or one of them failed
+				if (c == WSREAD_MESSAGEEND) {
+					if (!authPending || authFailed != CONF_PROJECTS) break;
+					if (!authReceived) logprintf("\r\nIgnored message without authentication response");
+					resIndex = 0;
+					authReceived = false;
+					jsonStart();
+					continue;
 				}
-			}
 
-			// Sets up to read WebSocket payload
-			logprintf("\r\nReceived authentication response:\r\n\t");
-			resMatchIndexes[0] = 0;
-			state = 0x19;
-		}
-		// Validates WebSocket payload for authentication
-		case 0x19: {
-			// Reads entire WebSocket authentication response
-			while (resIndex) {
-				const int16_t c = verbaleyes_socket_read();
+				// Prints entire WebSocket payload
+				logchar(c);
+				if (c == '\n') logchar('\t');
+
+				// Gets authentication response from records with the id of a project still waiting for it
+				if (jsonParse(c) != JSONPARSE_RECORD || !(json.record.fields & (1 << JSONFIELD_AUTH))) continue;
+				const uint8_t project = projectOfRecord();
+				if (project == CONF_PROJECTS || !(authPending & (1 << project))) continue;
+				authPending &= ~(1 << project);
+				authReceived = true;
+				if (json.record.auth != JSONTYPE_TRUE && authFailed == CONF_PROJECTS) authFailed = project;
+			}
+			jsonStart();
 
-				// Handles timeout error
-				if (c == EOF) return socketHadNoData();
+			// Validates authentication, every project has to be authenticated
+			if (authFailed != CONF_PROJECTS) {
+				// Server handled the pipelined handshake even though authentication failed
+				pipelineAttempt = false;
 
-				// Prints entire WebSocket payload
-				if (c == '\n') {
-					logprintf("\n\t");
-				}
-				else {
-					logprintf("%c", c);
-				}
+				logprintf("\r\nProject was rejected: %s", conf.proj[authFailed]);
+				const int8_t status = connectionFailToState("\r\nAuthentication failed", 0x90);
 
-				// Makes sure authentication was successful
-				if (resMatchIndexes[0] != SUCCESSFULMATCH && c > ' ') matchStr(&resMatchIndexes[0], c, "\"auth\":true");
-				resIndex--;
+				// Waits for a longer cool-down, updating proj or projkey retries right away
+				setTimeout(retryJitter(AUTHFAILEDDELAY));
+				return status;
 			}
 
-			// Validates authentication
-			if (resMatchIndexes[0] != SUCCESSFULMATCH) return connectionFailToState("\r\nAuthentication failed", 0x90);
-
 			// Moves on for successful authentication
 			logprintf("\r\nAuthenticated");
+			connectionFailures = 0;
+
+			// Counts down sequential handshakes so a server that only rejected pipelining temporarily gets it again
+			if (!pipelineAttempt && pipelineSkip) pipelineSkip--;
+			pipelineAttempt = false;
 		}
 		// Sets global values used for updating speed
 		case 0x20: {
-			// Gets deadzone percentage value from config
-			const uint8_t deadzone = verbaleyes_conf_read(CONF_ADDR_DEADZONE + 1);
-
-			// Gets minimum and maximum speed from config
-			const int16_t speedMin = confGetInt(CONF_ADDR_SPEEDMIN);
-			const int16_t speedMax = confGetInt(CONF_ADDR_SPEEDMAX);
-
-			// Gets calibration start and end point to use on analog read value
-			const uint16_t speedCalLow = confGetInt(CONF_ADDR_CALLOW);
-			const uint16_t speedCalHigh = confGetInt(CONF_ADDR_CALHIGH);
-
 			// Gets sensitivity value based on calibration range
-			const uint16_t sensitivity = confGetInt(CONF_ADDR_SENS);
+			const uint16_t sensitivity = conf.sensitivity;
 
 			// Sets helper values to use when mapping analog read value to new range
-			uint8_t deadzoneCapped = (deadzone > 99) ? 99 : deadzone;
-			deadzoneSize = (speedMax - speedMin) * 100 * deadzone / (100 - deadzoneCapped);
-			float speedSize = (speedMax - speedMin) * 100 + deadzoneSize;
-			speedMapper = speedSize / (speedCalHigh - speedCalLow);
-			speedOffset = speedMin * 100 - (speedCalLow * speedMapper);
-			jitterSize = sensitivity * speedMapper;
-
-			// Prints settings
-			logprintf(
-				"\r\nSetting up speed reader with:\r\n\tMaximum speed at: %i\r\n\tMinimum speed at: %i\r\n\tDeadzone at: %d%%\r\n\tCalibration low at: %u\r\n\tCalibration high at: %u\r\n\tSensitivity at: %d\r\n",
-				speedMax,
-				speedMin,
-				deadzone,
-				speedCalLow,
-				speedCalHigh,
-				sensitivity
-			);
+			if (speedStale & SPEEDMAPPING) {
+				// Gets deadzone percentage value from config
+				const uint8_t deadzone = conf.deadzone;
+
+				// Gets minimum and maximum speed from config
+				const int16_t speedMin = conf.speedmin;
+				const int16_t speedMax = conf.speedmax;
+
+				// Gets calibration start and end point to use on analog read value
+				const uint16_t speedCalLow = conf.callow;
+				const uint16_t speedCalHigh = conf.calhigh;
+
+				uint8_t deadzoneCapped = (deadzone > 99) ? 99 : deadzone;
+				deadzoneSize = (speedMax - speedMin) * 100 * deadzone / (100 - deadzoneCapped);
+				float speedSize = (speedMax - speedMin) * 100 + deadzoneSize;
+				speedMapper = speedSize / (speedCalHigh - speedCalLow);
+				speedOffset = speedMin * 100 - (speedCalLow * speedMapper);
+
+				// Prints settings
+				logprintf(
+					"\r\nSetting up speed reader with:\r\n\tMaximum speed at: %i\r\n\tMinimum speed at: %i\r\n\tDeadzone at: %d%%\r\n\tCalibration low at: %u\r\n\tCalibration high at: %u\r\n\tSensitivity at: %d\r\n",
+					speedMax,
+					speedMin,
+					deadzone,
+					speedCalLow,
+					speedCalHigh,
+					sensitivity
+				);
+			}
+			// Only prints sensitivity if nothing else changed
+			else if (speedStale & SPEEDJITTER) {
+				logprintf("\r\nSetting up speed reader with:\r\n\tSensitivity at: %d\r\n", sensitivity);
+			}
+
+			// Jitter size depends on both sensitivity and the mapping, reconnecting skips both
+			if (speedStale & SPEEDJITTER) {
+				jitterSize = sensitivity * speedMapper;
+			}
+
+			// Prints message rate limit, it is used directly from conf when sending
+			if (speedStale & SPEEDRATE) {
+				if (conf.maxrate) {
+					logprintf("\r\nLimiting messages to: %u per second\r\n", conf.maxrate);
+				}
+				else {
+					logprintf("\r\nMessages are not rate limited\r\n");
+				}
+			}
+			speedStale = 0;
 
 			// Sets state to be outside range now that it is done
 			state = 0xFF;
 		}
 	}
 
-	// Allows caller function to continue past this function
-	return VERBALEYES_INIT_DONE;
+	// Handles incoming data, allows caller function to continue past this function if connection is still alive
+	return wsPoll();
+}
+
+// Ensures connection, retries sending data the socket did not accept and prints everything logged one character at a time
+int8_t verbaleyes_initialize() {
+	const int8_t status = initialize();
+	socketSendFlush();
+	logflush();
+	return status;
 }
 
 // Sends remapped analog speed reading to the server
@@ -917,8 +2262,9 @@ void verbaleyes_setspeed(const uint16_t value) {
 	if (mappedValue != 0 && mappedValue <= speed + jitterSize && mappedValue >= speed - jitterSize) return;
 	speed = mappedValue;
 
-	// Sends new speed to the server
-	writeWebSocketFrame("[{\"id\": \"%s\", \"scrollSpeed\": %.2f}]", projID, (float)speed / 100);
+	// Queues new speed for the next message, replacing a previous speed that has not been sent
+	sendSpeed = speed;
+	sendSpeedPending = true;
 
 	// Prints new speed
 	logprintf("\r\nSpeed has been updated to: %.2f", (float)speed / 100);
@@ -933,9 +2279,14 @@ void verbaleyes_resetoffset(const bool value) {
 	buttonState = value;
 	if (value == 0) return;
 
-	// Sends message to server
-	writeWebSocketFrame("[{\"id\": \"%s\", \"scrollOffset\": 0}]", projID);
+	// Queues reset for the next message
+	sendOffsetPending = true;
 
 	// Prints
 	logprintf("\r\nScroll position has been set to: 0");
 }
+
+// Sends everything queued since the last call in a single message, called once at the end of every loop iteration
+void verbaleyes_flush() {
+	socketSendFlush();
+}
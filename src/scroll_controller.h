@@ -1,5 +1,5 @@
 #include <stdbool.h> // bool
-#include <stdint.h> // int8_t, uint8_t, int16_t, uint16_t
+#include <stdint.h> // int8_t, uint8_t, int16_t, uint16_t, uint32_t
 #include <stdlib.h> // size_t
 
 // Include Guard
@@ -10,13 +10,18 @@
 #define VERBALEYES_VERSION 0.5f
 
 // Number of characters required for configuration
-#define VERBALEYES_CONFIGLEN 269
+#define VERBALEYES_CONFIGLEN 463
 
 // Status values to return from verbaleyes_network_connected and verbaleyes_socket_connected
 #define VERBALEYES_CONNECT_SUCCESS (true)
 #define VERBALEYES_CONNECT_FAIL (false)
 #define VERBALEYES_CONNECT_WORKING (-1)
 
+// Status values to return from verbaleyes_conf_commit
+#define VERBALEYES_COMMIT_DONE (true)
+#define VERBALEYES_COMMIT_FAIL (false)
+#define VERBALEYES_COMMIT_WORKING (-1)
+
 // Status return values for verbaleyes_initialize
 #define VERBALEYES_INIT_DONE (false)
 #define VERBALEYES_INIT_WORKING (true)
@@ -30,13 +35,15 @@ extern "C" {
 // Prototypes for functions used to interact with the system
 int8_t verbaleyes_initialize();
 bool verbaleyes_configure(const int16_t);
+bool verbaleyes_configure_buffer(const char*, const size_t);
 void verbaleyes_setspeed(const uint16_t);
 void verbaleyes_resetoffset(const bool);
+void verbaleyes_flush();
 
 // Access to persistent storage
 extern char verbaleyes_conf_read(const uint16_t);
 extern void verbaleyes_conf_write(const uint16_t, const char);
-extern void verbaleyes_conf_commit();
+extern int8_t verbaleyes_conf_commit(const uint16_t, const uint16_t);
 
 // Interacts with network interface
 extern void verbaleyes_network_connect(const char*, const char*);
@@ -46,11 +53,18 @@ extern int8_t verbaleyes_network_connected();
 extern void verbaleyes_socket_connect(const char*, const uint16_t);
 extern int8_t verbaleyes_socket_connected();
 extern int16_t verbaleyes_socket_read();
-extern void verbaleyes_socket_write(const uint8_t*, const size_t);
+extern size_t verbaleyes_socket_read_buf(uint8_t*, const size_t);
+extern size_t verbaleyes_socket_write(const uint8_t*, const size_t);
 
 // Logs data to an interface
 extern void verbaleyes_log(const char*, const size_t);
 
+// Gets a monotonic time in milliseconds
+extern uint32_t verbaleyes_millis();
+
+// Gets a seed for the random number generator
+extern uint32_t verbaleyes_seed();
+
 // Ends extern c block
 #ifdef __cplusplus
 }
@@ -44,9 +44,9 @@ void verbaleyes_conf_write(const unsigned short addr, const char c) {
 	EEPROM.write(addr, c);
 }
 
-// Commits changes made in EEPROM to flash
-void verbaleyes_conf_commit() {
-	EEPROM.commit();
+// Commits changes made in EEPROM to flash, the entire sector is always rewritten in a single step
+int8_t verbaleyes_conf_commit(const unsigned short addr, const unsigned short len) {
+	return EEPROM.commit() ? VERBALEYES_COMMIT_DONE : VERBALEYES_COMMIT_FAIL;
 }
 
 
@@ -103,13 +103,19 @@ short verbaleyes_socket_read() {
 	return (clientUsingSSL) ? clientHTTPS.read() : clientHTTP.read();
 }
 
-// Sends a string to the endpoint the socket is connected to
-void verbaleyes_socket_write(const uint8_t* data, const size_t len) {
+// Consumes all available characters from the sockets response data buffer up to len
+size_t verbaleyes_socket_read_buf(uint8_t* buf, const size_t len) {
+	const int received = (clientUsingSSL) ? clientHTTPS.read(buf, len) : clientHTTP.read(buf, len);
+	return (received > 0) ? received : 0;
+}
+
+// Sends as much of a string as fits in the sockets send buffer to the endpoint the socket is connected to
+size_t verbaleyes_socket_write(const uint8_t* data, const size_t len) {
 	if (clientUsingSSL) {
-		clientHTTPS.write(data, len);
+		return clientHTTPS.write(data, min(len, (size_t)clientHTTPS.availableForWrite()));
 	}
 	else {
-		clientHTTP.write(data, len);
+		return clientHTTP.write(data, min(len, (size_t)clientHTTP.availableForWrite()));
 	}
 }
 
@@ -122,9 +128,16 @@ void verbaleyes_log(const char* str, const size_t len) {
 
 
 
-// Fills missing clock function. Used for getting random seed
-unsigned long clock() {
-	return micros();
+// Gets milliseconds since the device started
+uint32_t verbaleyes_millis() {
+	return millis();
+}
+
+
+
+// Gets random seed from the hardware random number generator
+uint32_t verbaleyes_seed() {
+	return RANDOM_REG32;
 }
 
 void setup() {
@@ -147,7 +160,8 @@ void loop() {
 	}
 
 	// Updates config data from serial input. Restarts loop if handling serial data
-	if (verbaleyes_configure(Serial.read())) {
+	char serialBuffer[64];
+	if (verbaleyes_configure_buffer(serialBuffer, Serial.read(serialBuffer, sizeof serialBuffer))) {
 		blinkMask = 0x100;
 		return;
 	}
@@ -164,6 +178,9 @@ void loop() {
 	// Jump to top of document if button at pin 0 is pulled high
 	verbaleyes_resetoffset(digitalRead(D3));
 
+	// Sends speed and position updates from this loop in a single message
+	verbaleyes_flush();
+
 	// Blinks light every 8192ms when idle
 	if (blinkMask != 0x1F00) {
 		blinkMask = 0x1F00;
@@ -6,11 +6,13 @@
 #ifdef _WIN32
 #include <winsock2.h> // timeval, socket, AF_INET, SOCK_STREAM, connect, htons, inet_addr, sockaddr_in, send, recv, INVALID_SOCKET, closesocket
 #include <windows.h>
+#define MSG_DONTWAIT 0
 #else
 #include <unistd.h> // STDIN_FILENO, close, usleep
-#include <sys/socket.h> // socket, AF_INET, SOCK_STREAM, connect, send, recv, setsockopt, SOL_SOCKET, SO_RCVTIMEO, sockaddr
+#include <sys/socket.h> // socket, AF_INET, SOCK_STREAM, connect, send, recv, setsockopt, SOL_SOCKET, SO_RCVTIMEO, sockaddr, MSG_DONTWAIT
 #include <arpa/inet.h> // htons, inet_addr, sockaddr_in
 #include <sys/time.h> // timeval
+#include <time.h> // timespec, clock_gettime, CLOCK_MONOTONIC, CLOCK_REALTIME
 #include <termios.h> // termios, tcgetattr, tcsetattr, TCSAFLUSH, ECHO, ICANON, VMIN, VTIME
 #define INVALID_SOCKET (-1)
 #define closesocket close
@@ -94,7 +96,7 @@ void verbaleyes_conf_write(const unsigned short addr, const char c) {
 
 // Commits changes made to config buffer to file
 char* pathToSelf;
-void verbaleyes_conf_commit() {
+int8_t verbaleyes_conf_commit(const unsigned short addr, const unsigned short len) {
 	// Opens self
 	FILE* file = fopen(pathToSelf, "r+");
 	if (file == NULL) {
@@ -102,16 +104,17 @@ void verbaleyes_conf_commit() {
 		exit(EXIT_FAILURE);
 	}
 
-	// Gets to start index for configuration
-	fseek(file, confFileIndex, SEEK_SET);
+	// Gets to start index for changed configuration
+	fseek(file, confFileIndex + addr, SEEK_SET);
 
-	// Writes configuration content
-	for (int i = 0; i < VERBALEYES_CONFIGLEN; i++) {
+	// Writes changed configuration content
+	for (int i = addr; i < addr + len; i++) {
 		fputc(confBuffer[i], file);
 	}
 
 	// Closes file stream
 	fclose(file);
+	return VERBALEYES_COMMIT_DONE;
 }
 
 
@@ -173,12 +176,16 @@ short verbaleyes_socket_read() {
 	return (recv(sockfd, &c, 1, 0) == -1) ? EOF : c;
 }
 
-// Sends a packet to the endpoint the socket is connected to
-void verbaleyes_socket_write(const uint8_t* packet, const size_t len) {
-	if (send(sockfd, packet, len, 0) != len) {
-		perror("\nERROR: Sending data to socket failed\n");
-		exit(EXIT_FAILURE);
-	}
+// Consumes all available characters from the sockets response data buffer up to len
+size_t verbaleyes_socket_read_buf(unsigned char* buf, const size_t len) {
+	const int received = recv(sockfd, (char*)buf, len, 0);
+	return (received > 0) ? received : 0;
+}
+
+// Sends as much of a packet as the socket accepts without waiting to the endpoint the socket is connected to
+size_t verbaleyes_socket_write(const uint8_t* packet, const size_t len) {
+	const int sent = send(sockfd, (const char*)packet, len, MSG_DONTWAIT);
+	return (sent > 0) ? sent : 0;
 }
 
 
@@ -195,6 +202,28 @@ void verbaleyes_log(const char* msg, const size_t len) {
 	fflush(stdout);
 }
 
+// Gets monotonic time in milliseconds
+uint32_t verbaleyes_millis() {
+#ifdef _WIN32
+	return GetTickCount();
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+// Gets random seed from the current time
+uint32_t verbaleyes_seed() {
+#ifdef _WIN32
+	return GetTickCount();
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return now.tv_sec ^ now.tv_nsec;
+#endif
+}
+
 
 
 // Initializes configuration buffer by reading concatenated config data from self
@@ -272,6 +301,7 @@ int main(int argc, char** argv) {
 		if (verbaleyes_initialize()) continue;
 		verbaleyes_setspeed(potSpeed);
 		// verbaleyes_resetoffset(digitalRead(0));
+		verbaleyes_flush();
 		usleep(20000);
 	}
 	return 0;
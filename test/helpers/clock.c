@@ -0,0 +1,37 @@
+#include <stdint.h>
+
+#include "../../src/scroll_controller.h"
+#include "./clock.h"
+
+// Virtual time in milliseconds, starts close to wrapping around to test that timeouts handle it
+static uint32_t clockTime = 0xFFFFF000;
+static uint32_t clockStep = 1;
+
+
+
+// VerbalEyes function to get virtual time, it moves forward by the step every time it is read
+uint32_t verbaleyes_millis() {
+	const uint32_t now = clockTime;
+	clockTime += clockStep;
+	return now;
+}
+
+// Moves virtual time forward instantly
+void clock_advance(const uint32_t ms) {
+	clockTime += ms;
+}
+
+// Sets how far virtual time moves forward every time it is read, 0 stops time
+void clock_setstep(const uint32_t ms) {
+	clockStep = ms;
+}
+
+// VerbalEyes function to get a random seed, it is fixed to generate the same keys and masks on every run
+uint32_t verbaleyes_seed() {
+	return 1;
+}
+
+// Gets virtual time without moving it forward
+uint32_t clock_now() {
+	return clockTime;
+}
@@ -0,0 +1,7 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+#include <stdint.h>
+void clock_advance(const uint32_t);
+void clock_setstep(const uint32_t);
+uint32_t clock_now();
+#endif
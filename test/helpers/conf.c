@@ -31,8 +31,9 @@ void verbaleyes_conf_write(const unsigned short addr, const char c) {
 }
 
 // VerbalEyes function to commit data to conf buffer
-void verbaleyes_conf_commit() {
+int8_t verbaleyes_conf_commit(const unsigned short addr, const unsigned short len) {
 	confCommited = 1;
+	return VERBALEYES_COMMIT_DONE;
 }
 
 // VerbalEyes function to read data from conf buffer
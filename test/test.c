@@ -1,10 +1,10 @@
 #include <stdio.h> // printf, fprintf, fflush, stdout, EOF, stderr
 #include <string.h> // strlen, memset, memcmp, strcmp
-#include <time.h> // time_t, time, NULL
 #include <stdbool.h> // bool, true, false
 
 #include "../src/scroll_controller.h"
 #include "./helpers/print_colors.h"
+#include "./helpers/clock.h"
 
 // Only defined to not throw compilation errors
 void verbaleyes_network_connect(const char* ssid, const char* key) {}
@@ -12,7 +12,7 @@ int8_t verbaleyes_network_connected() { return 1; }
 void verbaleyes_socket_connect(const char* host, const unsigned short port) {}
 int8_t verbaleyes_socket_connected() { return 0; }
 short verbaleyes_socket_read() { return 1; }
-void verbaleyes_socket_write(const uint8_t* str, const size_t len) {}
+size_t verbaleyes_socket_write(const uint8_t* str, const size_t len) { return len; }
 
 
 // All configurable strings lengths (copy from scroll_controller.c)
@@ -37,6 +37,13 @@ void verbaleyes_socket_write(const uint8_t* str, const size_t len) {}
 #define CONF_ADDR_CALLOW        (CONF_ADDR_DEADZONE + 2)
 #define CONF_ADDR_CALHIGH       (CONF_ADDR_CALLOW + 2)
 #define CONF_ADDR_SENS          (CONF_ADDR_CALHIGH + 2)
+#define CONF_ADDR_PROJ2         (CONF_ADDR_SENS + 2)
+#define CONF_ADDR_PROJKEY2      (CONF_ADDR_PROJ2 + CONF_LEN_PROJ)
+#define CONF_ADDR_PROJ3         (CONF_ADDR_PROJKEY2 + CONF_LEN_PROJKEY)
+#define CONF_ADDR_PROJKEY3      (CONF_ADDR_PROJ3 + CONF_LEN_PROJ)
+#define CONF_ADDR_PROJ4         (CONF_ADDR_PROJKEY3 + CONF_LEN_PROJKEY)
+#define CONF_ADDR_PROJKEY4      (CONF_ADDR_PROJ4 + CONF_LEN_PROJ)
+#define CONF_ADDR_MAXRATE       (CONF_ADDR_PROJKEY4 + CONF_LEN_PROJKEY)
 
 // Counter for the number of errors that occurs
 int numberOfErrors = 0;
@@ -123,6 +130,9 @@ char configBuffer[VERBALEYES_CONFIGLEN];
 // Commit state for configuration
 bool configCommit = false;
 
+// Number of times commit reports it is still working before it is done
+int configCommitSteps = 0;
+
 // Fills config buffer with CLEARBYTEs to separate from nullbytes written
 void clearConfigBuffer() {
 	memset(configBuffer, CLEARBYTE, VERBALEYES_CONFIGLEN);
@@ -207,6 +217,25 @@ void configureChar(const char c) {
 	verbaleyes_configure(c);
 }
 
+// Updates CRC-16/CCITT-FALSE checksum with one byte
+unsigned short crc16(unsigned short crc, const unsigned char c) {
+	crc ^= c << 8;
+	for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	return crc;
+}
+
+// Updates configuration with a binary frame created from version and payload
+void configureBinary(const unsigned char version, const char* payload, const int len, const bool validCRC) {
+	unsigned char frame[512] = { 0x02, version, len >> 8, len & 0xff };
+	memcpy(frame + 4, payload, len);
+	unsigned short crc = 0xffff;
+	for (int i = 1; i < len + 4; i++) crc = crc16(crc, frame[i]);
+	if (!validCRC) crc++;
+	frame[len + 4] = crc >> 8;
+	frame[len + 5] = crc & 0xff;
+	verbaleyes_configure_buffer((char*)frame, len + 6);
+}
+
 // Exits configuration mode
 void configureExit() {
 	configureString("\n\n");
@@ -263,16 +292,29 @@ void verbaleyes_conf_write(const unsigned short addr, const char c) {
 }
 
 // VerbalEyes function to commit data to conf buffer
-void verbaleyes_conf_commit() {
+int8_t verbaleyes_conf_commit(const unsigned short addr, const unsigned short len) {
 	// Disallow calling this function
 	if (!allowCallToConfigWrite) {
 		fprintf(stderr, "" COLOR_RED "Function verbaleyes_conf_commit was called without being allowed to\n" COLOR_NORMAL);
 		numberOfErrors++;
-		return;
+		return VERBALEYES_COMMIT_FAIL;
+	}
+
+	// Ensures range to commit is within config
+	if (len == 0 || addr + len > VERBALEYES_CONFIGLEN) {
+		fprintf(stderr, "" COLOR_RED "Commit range was invalid: %d %d\n" COLOR_NORMAL, addr, len);
+		numberOfErrors++;
+	}
+
+	// Simulates storage that requires multiple steps to commit
+	if (configCommitSteps > 0) {
+		configCommitSteps--;
+		return VERBALEYES_COMMIT_WORKING;
 	}
 
 	// Sets commit state to having commited the data
 	configCommit = true;
+	return VERBALEYES_COMMIT_DONE;
 }
 
 // VerbalEyes function to read data from conf buffer
@@ -430,6 +472,17 @@ void configTestInputs() {
 		true
 	);
 
+	// Tests that backspace restores keys that stopped matching
+	configTestString(
+		"Key backspace",
+		"ssix\x7F" "d=abc\n",
+		"\r\n[ ssix\b \bd ] is now: abc",
+		"\r\n",
+		CONF_ADDR_SSID,
+		"abc",
+		true
+	);
+
 	// Tests that an invalid key does not update anything
 	configTestEmpty(
 		"Key invalid",
@@ -650,7 +703,7 @@ void configTestInputs() {
 	// Tests that no data for a specified timeout would automatically exit configuration mode
 	configTestStart("Timeout aborted", "1\n", "\r\n[ 1", " ] Aborted\r\n");
 	fflush(stdout);
-	time_t t1 = time(NULL);
+	const uint32_t t1 = clock_now();
 	clearLogBuffer();
 	while (verbaleyes_configure(0));
 	if (!allowOverwritingConfigData) {
@@ -659,8 +712,8 @@ void configTestInputs() {
 	else {
 		compareLogToString("Configuration saved\r\n");
 	}
-	time_t t2 = time(NULL);
-	if (t2 - t1 < 2) {
+	const uint32_t t2 = clock_now();
+	if (t2 - t1 < 2000) {
 		fprintf(stderr, "" COLOR_RED "Timeout did not delay\n\n" COLOR_NORMAL);
 		numberOfErrors++;
 	}
@@ -744,13 +797,44 @@ void ensureShortConfigInteger(const char* key, const int offset) {
 	testEnd();
 }
 
+// Every configuration key, the gap test fails if an item in persistent storage is missing from this list
+const char* configKeys[] = {
+	"calhigh", "callow", "deadzone", "host", "maxrate", "path", "port", "proj", "proj2", "proj3", "proj4",
+	"projkey", "projkey2", "projkey3", "projkey4", "sensitivity", "speedmax", "speedmin", "ssid", "ssidkey"
+};
+
+// Ensures a key is matched and a longer key is not, fails if confItems is not sorted or CONFKEYMAXLEN is too short
+void configKeyLookup(const char* key) {
+	testStart("key lookup", key);
+	configureExit();
+
+	// Key has to match when delimiter is received
+	configureString(key);
+	configureChar('=');
+	if (!strstr(logBuffer, "] is now: ")) {
+		fprintf(stderr, "" COLOR_RED "Key was not matched\n" COLOR_NORMAL);
+		numberOfErrors++;
+	}
+	configureExit();
+
+	// Key with an extra character can not match anything
+	configureString(key);
+	configureString("x=");
+	if (!strstr(logBuffer, "No matching key")) {
+		fprintf(stderr, "" COLOR_RED "Key with extra character was matched\n" COLOR_NORMAL);
+		numberOfErrors++;
+	}
+	configureExit();
+	testEnd();
+}
+
 // All tests related to configuration
 void testConfiguration() {
 	// Enables log buffering
 	disableLogBuffering = false;
 
-	// Allows writing to config as that is what is tested, but reading should not occur
-	allowCallToConfigRead = false;
+	// Allows writing to config as that is what is tested, reading is used to skip writing unchanged data
+	allowCallToConfigRead = true;
 	allowCallToConfigWrite = true;
 
 	// Clears config buffer before tests
@@ -783,6 +867,174 @@ void testConfiguration() {
 	}
 	testEnd();
 
+	// Tests that a buffer is handled the same way as individual characters
+	testStart("configuration", "Buffer input");
+	configureExit();
+	clearConfigBuffer();
+	const char buf[] = "# comment\nssid=ab\x7F" "c\n\n";
+	if (!verbaleyes_configure_buffer(buf, strlen(buf))) {
+		fprintf(stderr, "" COLOR_RED "Updating configuration from buffer exited too early\n" COLOR_NORMAL);
+		numberOfErrors++;
+	}
+	if (verbaleyes_configure_buffer(NULL, 0)) {
+		fprintf(stderr, "" COLOR_RED "Empty buffer did not exit configuration mode\n" COLOR_NORMAL);
+		numberOfErrors++;
+	}
+	compareLogToString("\r\n[ ssid ] is now: ab\b \bc\r\nConfiguration saved\r\n");
+	compareConfigToBuffer(CONF_ADDR_SSID, "ac", 3);
+	compareConfigCommitState(true);
+	testEnd();
+
+	// Tests that configuring the same value again does not write or commit anything
+	testStart("configuration", "Unchanged value");
+	configureExit();
+	configureString("ssid=ac\n\n");
+	configureChar('\0');
+	clearLogBuffer();
+	configCommit = false;
+	allowCallToConfigWrite = false;
+	configureString("ssid=ac\n\n");
+	configureChar('\0');
+	allowCallToConfigWrite = true;
+	compareLogToString("\r\n[ ssid ] is now: ac\r\nConfiguration unchanged\r\n");
+	compareConfigCommitState(false);
+	testEnd();
+
+	// Tests that a commit can be stepped without blocking
+	testStart("configuration", "Stepped commit");
+	configureExit();
+	configureString("ssid=stepped\n\n");
+	clearLogBuffer();
+	configCommit = false;
+	configCommitSteps = 2;
+	configureChar('\0');
+	compareLogToString("Saving configuration\r\n");
+	compareConfigCommitState(false);
+	clearLogBuffer();
+	configureChar('\0');
+	compareLogToString("");
+	compareConfigCommitState(false);
+	configureChar('\0');
+	compareLogToString("Configuration saved\r\n");
+	compareConfigCommitState(true);
+	testEnd();
+
+	// Tests that new input only steps a commit once and is ignored until the commit is done
+	testStart("configuration", "Stepped commit interrupted");
+	configureExit();
+	configureString("ssid=stepped2\n\n");
+	clearLogBuffer();
+	configCommit = false;
+	configCommitSteps = 3;
+	configureChar('\0');
+	compareLogToString("Saving configuration\r\n");
+	clearLogBuffer();
+	if (!verbaleyes_configure('s') || !verbaleyes_configure('s')) {
+		fprintf(stderr, "" COLOR_RED "Configuration was not busy while saving\n" COLOR_NORMAL);
+		numberOfErrors++;
+	}
+	compareLogToString("Configuration is still being saved, input was ignored\r\n");
+	compareConfigCommitState(false);
+	clearLogBuffer();
+	configureString("ssid=ab\n\n");
+	compareLogToString("Configuration saved\r\n\r\n[ ssid ] is now: ab\r\n");
+	compareConfigCommitState(true);
+	configureChar('\0');
+	testEnd();
+
+	// Tests that a stepped commit that never completes times out
+	testStart("configuration", "Stepped commit timeout");
+	configureExit();
+	configureString("ssid=timeout\n\n");
+	clearLogBuffer();
+	configCommit = false;
+	configCommitSteps = 0xFFFF;
+	configureChar('\0');
+	clock_advance(CONFIGTIMEOUT);
+	configureChar('\0');
+	compareLogToString("Saving configuration\r\nConfiguration could not be saved\r\n");
+	compareConfigCommitState(false);
+	configCommitSteps = 0;
+	configureString("ssid=timeout2\n\n");
+	configureChar('\0');
+	compareConfigCommitState(true);
+	testEnd();
+
+	// Tests that a binary frame with multiple records is written and committed
+	testStart("configuration", "Binary frame");
+	configureExit();
+	clearConfigBuffer();
+	configureBinary(1, "\x00\x00\x00\x04" "abc\0" "\x00\x9f\x00\x02" "\x00\x50", 14, true);
+	compareLogToString("\r\n[ binary ] CRC 0x5F5C\r\n");
+	clearLogBuffer();
+	configureString("\n");
+	configureChar('\0');
+	compareLogToString("Configuration saved\r\n");
+	compareConfigToBuffer(CONF_ADDR_SSID, "abc", 4);
+	compareConfigToInteger(CONF_ADDR_PORT, "\x00\x50");
+	compareConfigCommitState(true);
+	testEnd();
+
+	// Tests that an incomplete binary frame times out
+	testStart("configuration", "Binary frame timeout");
+	configureExit();
+	clearConfigBuffer();
+	configureChar(0x02);
+	configureChar(0x01);
+	clearLogBuffer();
+	configureChar(EOF);
+	compareLogToString("");
+	clock_advance(CONFIGTIMEOUT);
+	configureChar(EOF);
+	compareLogToString(" ] Timed out\r\nConfiguration canceled\r\n");
+	testEnd();
+
+	// Tests that a binary frame with incorrect CRC does not write anything
+	testStart("configuration", "Binary frame CRC mismatch");
+	configureExit();
+	clearConfigBuffer();
+	configureBinary(1, "\x00\x00\x00\x04" "abc\0", 8, false);
+	configureString("\n");
+	configureChar('\0');
+	compareLogToString("\r\n[ binary ] CRC did not match\r\nConfiguration canceled\r\n");
+	if (configIsEmpty(0, VERBALEYES_CONFIGLEN)) {
+		printf("" COLOR_GREEN "Config was empty\n" COLOR_NORMAL);
+	}
+	compareConfigCommitState(false);
+	testEnd();
+
+	// Tests that a binary frame with a record outside configuration does not write anything
+	testStart("configuration", "Binary frame record out of range");
+	configureExit();
+	clearConfigBuffer();
+	configureBinary(1, "\x00\x00\x00\x01" "a" "\x01\xce\x00\x02" "\x00\x50", 11, true);
+	configureString("\n");
+	configureChar('\0');
+	compareLogToString("\r\n[ binary ] Invalid record\r\nConfiguration canceled\r\n");
+	if (configIsEmpty(0, VERBALEYES_CONFIGLEN)) {
+		printf("" COLOR_GREEN "Config was empty\n" COLOR_NORMAL);
+	}
+	testEnd();
+
+	// Tests that a binary frame with unknown version does not write anything
+	testStart("configuration", "Binary frame version");
+	configureExit();
+	clearConfigBuffer();
+	configureBinary(2, "\x00\x00\x00\x01" "a", 5, true);
+	configureString("\n");
+	configureChar('\0');
+	compareLogToString("\r\n[ binary ] Unsupported version (2)\r\nConfiguration canceled\r\n");
+	if (configIsEmpty(0, VERBALEYES_CONFIGLEN)) {
+		printf("" COLOR_GREEN "Config was empty\n" COLOR_NORMAL);
+	}
+	testEnd();
+
+
+
+	// Tests that every key is found by the key matcher
+	printf("\n\n");
+	for (int i = 0; i < sizeof(configKeys) / sizeof(configKeys[0]); i++) configKeyLookup(configKeys[i]);
+
 
 
 	// Tests address mapping
@@ -803,6 +1055,13 @@ void testConfiguration() {
 	configAddrRangeInteger("callow", CONF_ADDR_CALLOW);
 	configAddrRangeInteger("calhigh", CONF_ADDR_CALHIGH);
 	configAddrRangeInteger("sensitivity", CONF_ADDR_SENS);
+	configAddrRangeString("proj2", CONF_ADDR_PROJ2, CONF_LEN_PROJ);
+	configAddrRangeString("projkey2", CONF_ADDR_PROJKEY2, CONF_LEN_PROJKEY);
+	configAddrRangeString("proj3", CONF_ADDR_PROJ3, CONF_LEN_PROJ);
+	configAddrRangeString("projkey3", CONF_ADDR_PROJKEY3, CONF_LEN_PROJKEY);
+	configAddrRangeString("proj4", CONF_ADDR_PROJ4, CONF_LEN_PROJ);
+	configAddrRangeString("projkey4", CONF_ADDR_PROJKEY4, CONF_LEN_PROJKEY);
+	configAddrRangeInteger("maxrate", CONF_ADDR_MAXRATE);
 
 	// Checks configuration buffer for gaps
 	printf("\n\n");
@@ -822,6 +1081,13 @@ void testConfiguration() {
 	fillConfigInteger("callow");
 	fillConfigInteger("calhigh");
 	fillConfigInteger("sensitivity");
+	fillConfigString("proj2");
+	fillConfigString("projkey2");
+	fillConfigString("proj3");
+	fillConfigString("projkey3");
+	fillConfigString("proj4");
+	fillConfigString("projkey4");
+	fillConfigInteger("maxrate");
 	int foundGaps = 0;
 	for (int i = 0; i < VERBALEYES_CONFIGLEN; i++) {
 		if (configBuffer[i] != '0') {
@@ -855,6 +1121,13 @@ void testConfiguration() {
 	ensureShortConfigInteger("callow", CONF_ADDR_CALLOW);
 	ensureShortConfigInteger("calhigh", CONF_ADDR_CALHIGH);
 	ensureShortConfigInteger("sensitivity", CONF_ADDR_SENS);
+	ensureShortConfigString("proj2", CONF_ADDR_PROJ2);
+	ensureShortConfigString("projkey2", CONF_ADDR_PROJKEY2);
+	ensureShortConfigString("proj3", CONF_ADDR_PROJ3);
+	ensureShortConfigString("projkey3", CONF_ADDR_PROJKEY3);
+	ensureShortConfigString("proj4", CONF_ADDR_PROJ4);
+	ensureShortConfigString("projkey4", CONF_ADDR_PROJKEY4);
+	ensureShortConfigInteger("maxrate", CONF_ADDR_MAXRATE);
 }
 
 
@@ -13,7 +13,7 @@ int8_t verbaleyes_network_connected() { return 0; }
 void verbaleyes_socket_connect(const char* host, const unsigned short port) {}
 int8_t verbaleyes_socket_connected() { return 0; }
 short verbaleyes_socket_read() { return 0; }
-void verbaleyes_socket_write(const uint8_t* str, const size_t len) {}
+size_t verbaleyes_socket_write(const uint8_t* str, const size_t len) { return len; }
 
 
 
@@ -46,6 +46,11 @@ int main() {
 	printf("" COLOR_BLUE "Testing config_clear script:\n" COLOR_NORMAL);
 	char buf[VERBALEYES_CONFIGLEN];
 	memset(buf, '0', VERBALEYES_CONFIGLEN);
+
+	// Additional projects are emptied after being cleared so they are not used, these are the addresses of proj2 to proj4
+	buf[269] = '\0';
+	buf[333] = '\0';
+	buf[397] = '\0';
 	conf_cmp(0, buf, VERBALEYES_CONFIGLEN);
 	conf_matchcommit(1);
 	printf("" COLOR_GREEN "Test successful: Entire configuration can be cleared correctly\n\n" COLOR_NORMAL);
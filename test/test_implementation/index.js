@@ -387,7 +387,7 @@ async function testSocket() {
 			console.log("[√] Did not get any scroll data before authenticated");
 
 			// Sends authentication response
-			ws.send(`[{"id": !!, "auth": true}]`);//!!
+			ws.send(JSON.stringify([{ id: proj, auth: true }]));
 
 			// Completes socket test
 			console.log("[√] Connected to the server");
@@ -1,7 +1,6 @@
 #include <stdio.h> // printf, fprintf, stderr
-#include <string.h> // strlen
+#include <string.h> // strlen, memcmp
 #include <stdbool.h> // bool
-#include <time.h> // clock_t
 
 #include "../src/scroll_controller.h"
 
@@ -9,6 +8,7 @@
 #include "./helpers/conf.h"
 #include "./helpers/log.h"
 #include "./helpers/debug.h"
+#include "./helpers/clock.h"
 
 
 
@@ -47,6 +47,19 @@ int testState = 0;
 bool testDroppedConnection = false;
 int testReadIndex = 0;
 
+// Number of consecutive failures, used to know how long it should back off
+int testFailures = 0;
+
+// First test running on an authenticated connection, frames written from here on are collected and compared
+#define TESTCONNECTED 20
+
+// Test where a project is rejected, it waits for the authentication cool-down instead of backing off
+#define TESTAUTHREJECTED 31
+
+// Default number of milliseconds without data before the controller pings the server and before it reconnects
+#define PINGINTERVAL 5000
+#define IDLETIMEOUT 10000
+
 
 
 // Tests length and value of ssid and ssidkey
@@ -176,9 +189,17 @@ int8_t verbaleyes_socket_connected() {
 #define HTTP_HEADER_UPGRADE_WRONG "Upgrade: HTTP/2.0\r\n"
 #define HTTP_HEADER_UPGRADE "Upgrade: websocket\r\n"
 #define HTTP_HEADER_KEY_WRONG "Sec-WebSocket-Accept: dGhlIHNhbXBsZSBub25jZQ==\r\n"
-#define HTTP_HEADER_KEY "Sec-WebSocket-Accept: KM6afhWtO4bb/E9amIx6hTrgkCw=\r\n"
+#define HTTP_HEADER_KEY "Sec-WebSocket-Accept: A90w8aBkQD2ztaf1WEClfVxuVGM=\r\n"
 #define HTTP_HEADER_EXTENSION "Sec-WebSocket-Extensions: yes\r\n"
 #define HTTP_HEADER_PROTOCOL "Sec-WebSocket-Protocol: yes\r\n"
+#define HTTP_HEADER_CONNECTION_LIST "connection:keep-alive,  UPGRADE \r\n"
+#define HTTP_HEADER_UPGRADE_CASE "UPGRADE:\tWebSocket\n"
+
+// WebSocket messages
+#define WS_BROADCAST "[{\"id\": \"other\", \"scrollSpeed\": 1.5}]"
+#define WS_AUTH "[{\"id\": \"eee\", \"auth\": true}]"
+#define WS_AUTH_TWO "[{\"id\": \"eee\", \"auth\": true}, {\"id\": \"ggg\", \"auth\": true}]"
+#define WS_AUTH_REJECTED "[{\"id\": \"eee\", \"auth\": true}, {\"id\": \"ggg\", \"auth\": false}]"
 
 // Gets next character of string cast to signed char for -1
 int16_t getReadData(char* data) {
@@ -186,6 +207,21 @@ int16_t getReadData(char* data) {
  	return (int8_t)data[testReadIndex++];
 }
 
+// Gets next byte of data that can contain null characters, such as WebSocket frames with extended lengths
+int16_t getReadBytes(const char* data, const size_t len) {
+	if (testReadIndex >= len) return EOF;
+	return (uint8_t)data[testReadIndex++];
+}
+#define READBYTES(data) getReadBytes(data, sizeof(data) - 1)
+
+// WebSocket frames sent by the server after authentication
+#define WS_FRAGMENTED "\x01\x7f\0\0\0\0\0\0\0\x0a" "[{\"id\": \"e" "\x89\x02" "hi" "\x00\x7e\0\x0a" "ee\", \"scro" "\x80\x0f" "llSpeed\": 2.5}]"
+#define WS_BROADCAST_LONG "\x81\x7f\0\0\0\0\0\0\0\x25" WS_BROADCAST
+#define WS_OFFSET "\x81\x23" "[{\"id\": \"eee\", \"scrollOffset\": 40}]"
+#define WS_CLOSE "\x88\x02\x03\xe8"
+#define WS_UNKNOWN "\x83\x00"
+#define WS_PONG "\x8a\x00"
+
 // Reads socket data
 int16_t verbaleyes_socket_read() {
 	switch (testState) {
@@ -231,6 +267,47 @@ int16_t verbaleyes_socket_read() {
 		// Tests present protocol
 		case 17: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION HTTP_HEADER_UPGRADE HTTP_HEADER_KEY HTTP_HEADER_PROTOCOL "\r\n");
 
+		// Tests header names in any case, whitespace around values, a list of connection values and bare line feeds
+		case 18: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION_LIST HTTP_HEADER_UPGRADE_CASE HTTP_HEADER_KEY_WRONG "\r\n");
+
+		// Tests message for another project arriving before authentication response
+		case 19: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION HTTP_HEADER_UPGRADE HTTP_HEADER_KEY "\r\n" "\x81\x25" WS_BROADCAST "\x81\x1d" WS_AUTH);
+		// Tests updates sent by the sketch while the server is quiet
+		case 20: return EOF;
+		case 21: return EOF;
+		case 22: return EOF;
+		case 23: return EOF;
+		// Tests message fragmented with 64 and 16 bit lengths around a ping, then a long message for another project that is skipped
+		case 24: return READBYTES(WS_FRAGMENTED WS_BROADCAST_LONG WS_OFFSET);
+		// Tests close from server
+		case 25: return READBYTES(WS_CLOSE);
+		// Tests reconnecting after close
+		case 26: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION HTTP_HEADER_UPGRADE HTTP_HEADER_KEY "\r\n" "\x81\x1d" WS_AUTH);
+		// Tests frame with an unknown opcode
+		case 27: return READBYTES(WS_UNKNOWN);
+		// Tests authenticating two projects
+		case 28: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION HTTP_HEADER_UPGRADE HTTP_HEADER_KEY "\r\n" "\x81\x3a" WS_AUTH_TWO);
+		// Tests speed being sent to both projects
+		case 29: return EOF;
+		// Tests close from server before reconnecting
+		case 30: return READBYTES(WS_CLOSE);
+		// Tests second project being rejected
+		case 31: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION HTTP_HEADER_UPGRADE HTTP_HEADER_KEY "\r\n" "\x81\x3b" WS_AUTH_REJECTED);
+		// Tests reconnecting after authentication failed
+		case 32: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION HTTP_HEADER_UPGRADE HTTP_HEADER_KEY "\r\n" "\x81\x3a" WS_AUTH_TWO);
+		// Tests ping sent to a quiet server
+		case 33: return EOF;
+		// Tests pong from server
+		case 34: return READBYTES(WS_PONG);
+		// Tests pong resetting the time the server has been quiet
+		case 35: return EOF;
+		// Tests reconnecting when the server stays quiet
+		case 36: return EOF;
+		// Tests reconnecting after the server stopped responding
+		case 37: return getReadData(EOFS HTTP_STATUS HTTP_HEADER_CONNECTION HTTP_HEADER_UPGRADE HTTP_HEADER_KEY "\r\n" "\x81\x3a" WS_AUTH_TWO);
+		// Tests a message written a few bytes at a time
+		case 38: return EOF;
+
 		// There should be a case for every test calling this function
 		default: {
 			fprintf(stderr, "" COLOR_RED "Called verbaleyes_socket_read with unknown test: %d\n" COLOR_NORMAL, testState);
@@ -239,21 +316,98 @@ int16_t verbaleyes_socket_read() {
 	}
 }
 
+// Maximum number of bytes the socket accepts per write, 0 for no limit
+size_t testWriteLimit = 0;
+
+// Indicates if the upgrade request was written in the current test and if authentication was written together with it
+bool testRequestWritten = false;
+bool testRequestPipelined = false;
+
+// Gets if the authentication should be pipelined with the upgrade request in the current test
+bool expectPipelined() {
+#if PIPELINEDHANDSHAKE
+	// The handshake rejected in test 6 makes the following ones sequential until there has been PIPELINERETRY successes
+	return testState <= 6 || testState > 19;
+#else
+	return false;
+#endif
+}
+
+// Frames written by the controller, unmasked and printed as the first byte in hex followed by the payload
+char wsWritten[1024];
+size_t wsWrittenLen = 0;
+
+// Bytes written by the controller that do not make up a complete frame yet
+uint8_t wsWriteBuffer[256];
+size_t wsWriteLen = 0;
+
+// Unmasks every complete frame written by the controller and appends it to wsWritten
+void collectFrames(const uint8_t* str, const size_t len) {
+	if (wsWriteLen + len > sizeof(wsWriteBuffer)) {
+		fprintf(stderr, "" COLOR_RED "Too much data written without a complete frame\n" COLOR_NORMAL);
+		exit(EXIT_FAILURE);
+	}
+	memcpy(wsWriteBuffer + wsWriteLen, str, len);
+	wsWriteLen += len;
+
+	while (wsWriteLen >= 2) {
+		// Frames from the client must be masked
+		if (!(wsWriteBuffer[1] & 0x80)) {
+			fprintf(stderr, "" COLOR_RED "Frame was written without a mask\n" COLOR_NORMAL);
+			numberOfErrors++;
+		}
+
+		// Gets payload length, the controller never writes frames that need a 64 bit length
+		size_t headerLen = 6;
+		size_t payloadLen = wsWriteBuffer[1] & 0x7F;
+		if (payloadLen == 126) {
+			if (wsWriteLen < 4) return;
+			headerLen = 8;
+			payloadLen = wsWriteBuffer[2] << 8 | wsWriteBuffer[3];
+		}
+		if (wsWriteLen < headerLen + payloadLen) return;
+
+		// Unmasks payload
+		if (wsWrittenLen + 4 + payloadLen >= sizeof(wsWritten)) {
+			fprintf(stderr, "" COLOR_RED "Too many frames written without clearing\n" COLOR_NORMAL);
+			exit(EXIT_FAILURE);
+		}
+		const uint8_t* mask = wsWriteBuffer + headerLen - 4;
+		wsWrittenLen += sprintf(wsWritten + wsWrittenLen, "<%02x>", wsWriteBuffer[0]);
+		for (size_t i = 0; i < payloadLen; i++) {
+			wsWritten[wsWrittenLen++] = wsWriteBuffer[headerLen + i] ^ mask[i % 4];
+		}
+		wsWritten[wsWrittenLen] = '\0';
+
+		// Removes frame from buffer
+		wsWriteLen -= headerLen + payloadLen;
+		memmove(wsWriteBuffer, wsWriteBuffer + headerLen + payloadLen, wsWriteLen);
+	}
+}
+
 // WebSocket request strings for writing or comparing reads
 #define WS_REQ "GET ddd HTTP/1.1\r\nHost: ccc\r\nConnection: Upgrade\r\nUpgrade: websocket\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: "
-#define WS_KEY "nxZqCIY+DNYVMizHXRYUvQ=="
-
-// Forces same random seed to be used every time
-clock_t clock() { return 1; }
+#define WS_KEY "IygpIzpm2vZwzHw30uHkLg=="
 
 // Writes socket data
-void verbaleyes_socket_write(const uint8_t* str, const size_t len) {
+size_t verbaleyes_socket_write(const uint8_t* str, size_t len) {
+	// Accepts only part of the data like a socket with a full send buffer
+	if (testWriteLimit && len > testWriteLimit) len = testWriteLimit;
+
+	// Skips upgrade request, anything written together with it is the pipelined authentication
+	size_t requestLen = 0;
+	if (len >= 4 && !memcmp(str, "GET ", 4)) {
+		while (requestLen < len && (requestLen < 4 || memcmp(str + requestLen - 4, "\r\n\r\n", 4))) requestLen++;
+		testRequestWritten = true;
+		testRequestPipelined = requestLen < len;
+	}
+
 	switch (testState) {
 		// Tests WebSocket request / path
 		case 5: {
 			// Tests content of WebSocket request
 			if (useShortConf) {
-				if (strcmp((char*)str, WS_REQ WS_KEY "\r\n\r\n")) {
+				if (requestLen != strlen(WS_REQ WS_KEY "\r\n\r\n") || memcmp(str, WS_REQ WS_KEY "\r\n\r\n", requestLen)) {
 					fprintf(stderr, "" COLOR_RED "HTTP request does not look correct\n" COLOR_NORMAL);
 					numberOfErrors++;
 				}
@@ -271,8 +425,15 @@ void verbaleyes_socket_write(const uint8_t* str, const size_t len) {
 					numberOfErrors++;
 				}
 			}
+			break;
+		}
+		// Collects frames after authentication, the HTTP request of a reconnect is not a frame
+		default: {
+			if (testState < TESTCONNECTED) break;
+			collectFrames(str + requestLen, len - requestLen);
 		}
 	}
+	return len;
 }
 
 
@@ -296,6 +457,21 @@ void verbaleyes_socket_write(const uint8_t* str, const size_t len) {
 
 // Log messages used for WebSocket
 #define LOG_WS_1 "\r\nWebSocket connection established"
+#define LOG_WS_2 "\r\nConnecting to project: eee..."
+#define LOG_WS_3 "\r\nReceived message:\r\n\t"
+#define LOG_WS_4 "\r\nIgnored message without authentication response"
+#define LOG_WS_5 "\r\nAuthenticated"
+
+// Log message for speed mapping
+#define LOG_SPEED "\r\nSetting up speed reader with:\r\n\tMaximum speed at: 2222\r\n\tMinimum speed at: 3333\r\n\tDeadzone at: 92%\r\n\tCalibration low at: 5555\r\n\tCalibration high at: 6666\r\n\tSensitivity at: 7777\r\n" "\r\nLimiting messages to: 8888 per second\r\n"
+
+// Log messages for updates after authentication
+#define LOG_CONF_SPEED "\r\n[ speedmax ] is now: 100\r\n[ speedmin ] is now: 0\r\n[ deadzone ] is now: 0\r\n[ callow ] is now: 0\r\n[ calhigh ] is now: 100\r\n[ sensitivity ] is now: 0\r\n[ maxrate ] is now: 1\r\n"
+#define LOG_SPEED_SIMPLE "\r\nSetting up speed reader with:\r\n\tMaximum speed at: 100\r\n\tMinimum speed at: 0\r\n\tDeadzone at: 0%\r\n\tCalibration low at: 0\r\n\tCalibration high at: 100\r\n\tSensitivity at: 0\r\n" "\r\nLimiting messages to: 1 per second\r\n"
+#define LOG_SEND_SPEED "\r\nSpeed has been updated to: "
+#define LOG_SEND_OFFSET "\r\nScroll position has been set to: 0"
+#define LOG_SERVER_SPEED "\r\nSpeed of eee was updated by the server to: "
+#define LOG_SERVER_OFFSET "\r\nScroll position of eee was set by the server to: "
 
 // Other log messages
 #define LOG_PROGRESSBAR ".."
@@ -339,46 +515,197 @@ char* logs[] = {
 
 	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t" HTTP_HEADER_EXTENSION "\t\r\n\t" "\r\nUnexpected WebSocket Extension header",
 
-	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t" HTTP_HEADER_PROTOCOL "\t\r\n\t" "\r\nUnexpected WebSocket Protocol header"
+	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t" HTTP_HEADER_PROTOCOL "\t\r\n\t" "\r\nUnexpected WebSocket Protocol header",
+
+	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION_LIST "\t" HTTP_HEADER_UPGRADE_CASE "\t" HTTP_HEADER_KEY_WRONG "\t\r\n\t" "\r\nMissing or incorrect WebSocket accept header",
+
+	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t\r\n\t" LOG_WS_1 LOG_WS_2 LOG_WS_3 WS_BROADCAST LOG_WS_4 LOG_WS_3 WS_AUTH LOG_WS_5 LOG_SPEED,
+	LOG_CONF_SPEED LOG_SPEED_SIMPLE,
+	LOG_SEND_SPEED "20.00" LOG_SEND_SPEED "50.00" LOG_SEND_OFFSET,
+	LOG_SEND_SPEED "60.00" LOG_SEND_SPEED "70.00" LOG_SEND_SPEED "80.00",
+	"",
+	LOG_SERVER_SPEED "2.50" LOG_SERVER_OFFSET "40",
+	"\r\nConnection closed by server",
+	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t\r\n\t" LOG_WS_1 LOG_WS_2 LOG_WS_3 WS_AUTH LOG_WS_5,
+	"\r\nReceived a WebSocket frame with an unknown opcode",
+	"\r\n[ proj2 ] is now: ggg\r\n[ projkey2 ] is now: hhh\r\n" LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t\r\n\t" LOG_WS_1 "\r\nConnecting to project: eee, ggg..." LOG_WS_3 WS_AUTH_TWO LOG_WS_5,
+	LOG_SEND_SPEED "90.00",
+	"\r\nConnection closed by server",
+	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t\r\n\t" LOG_WS_1 "\r\nConnecting to project: eee, ggg..." LOG_WS_3 WS_AUTH_REJECTED "\r\nProject was rejected: ggg\r\nAuthentication failed",
+	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t\r\n\t" LOG_WS_1 "\r\nConnecting to project: eee, ggg..." LOG_WS_3 WS_AUTH_TWO LOG_WS_5,
+	"",
+	"",
+	"",
+	"\r\nServer stopped responding",
+	LOG_SOCKET_1 LOG_SOCKET_3 LOG_INLINE HTTP_STATUS "\t" HTTP_HEADER_CONNECTION "\t" HTTP_HEADER_UPGRADE "\t" HTTP_HEADER_KEY "\t\r\n\t" LOG_WS_1 "\r\nConnecting to project: eee, ggg..." LOG_WS_3 WS_AUTH_TWO LOG_WS_5,
+	LOG_SEND_SPEED "40.00" LOG_SEND_OFFSET
+};
 
+// List of frames written in the tests after authentication
+char* frames[] = {
+	"",
+	"<81>[{\"id\": \"eee\", \"scrollSpeed\": 50.00}, {\"id\": \"eee\", \"scrollOffset\": 0}]",
+	"<81>[{\"id\": \"eee\", \"scrollSpeed\": 60.00}]",
+	"<81>[{\"id\": \"eee\", \"scrollSpeed\": 80.00}]",
+	"<8a>hi",
+	"<88>\x03\xe8",
+	"<81>[{\"id\": \"eee\", \"auth\": \"fff\"}]",
+	"<88>\x03\xea",
+	"<81>[{\"id\": \"eee\", \"auth\": \"fff\"}, {\"id\": \"ggg\", \"auth\": \"hhh\"}]",
+	"<81>[{\"id\": \"eee\", \"scrollSpeed\": 90.00}, {\"id\": \"ggg\", \"scrollSpeed\": 90.00}]",
+	"<88>\x03\xe8",
+	"<81>[{\"id\": \"eee\", \"auth\": \"fff\"}, {\"id\": \"ggg\", \"auth\": \"hhh\"}]",
+	"<81>[{\"id\": \"eee\", \"auth\": \"fff\"}, {\"id\": \"ggg\", \"auth\": \"hhh\"}]",
+	"<89>",
+	"",
+	"<89>",
+	"",
+	"<81>[{\"id\": \"eee\", \"auth\": \"fff\"}, {\"id\": \"ggg\", \"auth\": \"hhh\"}]",
+	"<81>[{\"id\": \"eee\", \"scrollSpeed\": 40.00}, {\"id\": \"ggg\", \"scrollSpeed\": 40.00}, {\"id\": \"eee\", \"scrollOffset\": 0}, {\"id\": \"ggg\", \"scrollOffset\": 0}]"
 };
 
+// Changes made by the sketch before running a test
+void testActions() {
+	switch (testState) {
+		// Changes speed mapping to one where the sent values are easy to read and limits messages to 1 per second
+		case 20: {
+			configure_str("speedmax=100\nspeedmin=0\ndeadzone=0\ncallow=0\ncalhigh=100\nsensitivity=0\nmaxrate=1\n");
+			verbaleyes_configure('\n');
+			break;
+		}
+		// Tests speed and offset changed in the same loop iteration being sent in one message with only the latest speed
+		case 21: {
+			verbaleyes_setspeed(20);
+			verbaleyes_setspeed(50);
+			verbaleyes_resetoffset(0);
+			verbaleyes_resetoffset(1);
+			break;
+		}
+		// Tests the last token in the bucket being used and the following speeds being held back
+		case 22: {
+			verbaleyes_setspeed(60);
+			verbaleyes_flush();
+			verbaleyes_setspeed(70);
+			verbaleyes_flush();
+			verbaleyes_setspeed(80);
+			verbaleyes_flush();
+			break;
+		}
+		// Tests the latest speed being sent once the bucket has refilled
+		case 23: {
+			clock_advance(1000);
+			break;
+		}
+		// Adds a second project
+		case 28: {
+			configure_str("proj2=ggg\nprojkey2=hhh\n");
+			verbaleyes_configure('\n');
+			break;
+		}
+		// Tests a speed update being sent to all projects
+		case 29: {
+			verbaleyes_setspeed(90);
+			break;
+		}
+		// Lets the server be quiet until a ping is sent
+		case 33: {
+			clock_advance(PINGINTERVAL);
+			break;
+		}
+		// Lets the server be quiet until the idle timeout would have been reached if the pong did not count
+		case 35: {
+			clock_advance(IDLETIMEOUT - PINGINTERVAL + 1000);
+			break;
+		}
+		// Lets the server be quiet until the idle timeout
+		case 36: {
+			clock_advance(IDLETIMEOUT);
+			break;
+		}
+		// Tests a message being written in order when the socket only accepts a few bytes on every loop iteration
+		case 38: {
+			testWriteLimit = 5;
+			verbaleyes_setspeed(40);
+			verbaleyes_resetoffset(0);
+			verbaleyes_resetoffset(1);
+			verbaleyes_flush();
+			if (wsWrittenLen) {
+				fprintf(stderr, "" COLOR_RED "Message was written entirely by a single short write\n" COLOR_NORMAL);
+				numberOfErrors++;
+			}
+			for (int i = 0; i < 100; i++) verbaleyes_initialize();
+			break;
+		}
+	}
+}
+
 // Runs a test
 void testInit() {
 	// Prints test id
 	printf("" COLOR_BLUE "\nTest: %d\n" COLOR_NORMAL, testState);
 	fflush(stdout);
 
-	// Clears log buffer
+	// Clears log buffer and collected frames
 	log_clear();
+	wsWrittenLen = 0;
+	wsWritten[0] = '\0';
+	testRequestWritten = false;
+
+	// Runs changes made by the sketch
+	testActions();
 
 	// Run initialize function until error or success
 	int8_t state;
 	while ((state = verbaleyes_initialize()) == VERBALEYES_INIT_WORKING);
 
-	// Ensures that it delays before continuing after fail
+	// Ensures that it backs off before continuing after fail, jitter can shorten the delay down to half
 	if (state == -1) {
-		time_t start = time(NULL);
-		while (start == time(NULL)) {
+		uint32_t delay = CONNECTIONFAILEDMAXDELAY;
+		if (((uint32_t)CONNECTIONFAILEDDELAY << testFailures) < delay) delay = CONNECTIONFAILEDDELAY << testFailures;
+		if (testState == TESTAUTHREJECTED) delay = AUTHFAILEDDELAY;
+		testFailures++;
+		const uint32_t start = clock_now();
+		while (clock_now() - start < delay / 2) {
 			if (verbaleyes_initialize() == VERBALEYES_INIT_WORKING) continue;
 			fprintf(stderr, "" COLOR_RED "Continued processing when it should not have\n" COLOR_NORMAL);
 			numberOfErrors++;
 		}
 	}
 
+	// A successful connection resets the backoff
+	else if (state == VERBALEYES_INIT_DONE) {
+		testFailures = 0;
+	}
+
 	// Compare log buffer
 	if (useShortConf) log_cmp(logs[testState]);
 
+	// Compares if authentication was pipelined with the upgrade request
+	if (testRequestWritten && testRequestPipelined != expectPipelined()) {
+		fprintf(stderr, "" COLOR_RED "Authentication was %s with the upgrade request\n" COLOR_NORMAL, (testRequestPipelined) ? "pipelined" : "not pipelined");
+		numberOfErrors++;
+	}
+
+	// Compares frames written after authentication
+	if (testState >= TESTCONNECTED && strcmp(wsWritten, frames[testState - TESTCONNECTED])) {
+		fprintf(stderr, "" COLOR_RED "Frames did not match:\n|>%s<|\n|>%s<|\n" COLOR_NORMAL, wsWritten, frames[testState - TESTCONNECTED]);
+		numberOfErrors++;
+	}
+
 	// Increments test state for next test
 	testState++;
 	testDroppedConnection = false;
 	testReadIndex = 0;
+	testWriteLimit = 0;
 }
 
 
 
 // Tests initilization function with long or short names
 void runTests(bool useShort) {
+	// Erases storage after the original configuration like on an upgraded device, projects that are not configured read as 0xFF
+	memset(confBuffer + 269, 0xFF, VERBALEYES_CONFIGLEN - 269);
+
 	// Updates all config items
 	useShortConf = useShort;
 	fillConfChar("ssid", 'a');
@@ -394,6 +721,7 @@ void runTests(bool useShort) {
 	configure_str("callow=5555\n");
 	configure_str("calhigh=6666\n");
 	configure_str("sensitivity=7777\n");
+	configure_str("maxrate=8888\n");
 	verbaleyes_configure('\n');
 	printf("\n\n");
 
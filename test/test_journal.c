@@ -0,0 +1,249 @@
+#include <stdio.h> // printf, fprintf, fflush, stdout, stderr
+#include <string.h> // memset, memcpy, memcmp
+#include <stdbool.h> // bool, true, false
+#include <stdlib.h> // exit, EXIT_SUCCESS, EXIT_FAILURE
+
+#include "../src/scroll_controller.h"
+#include "../src/conf_journal.h"
+#include "./helpers/print_colors.h"
+
+#define FLASHLEN (VERBALEYES_JOURNAL_SECTORSIZE * VERBALEYES_JOURNAL_SECTORS)
+
+// Counter for the number of errors that occurs
+int numberOfErrors = 0;
+
+// Emulated flash where writes can only clear bits like NOR flash
+uint8_t flash[FLASHLEN];
+int flashErases[VERBALEYES_JOURNAL_SECTORS];
+long flashBytesRead = 0;
+
+// Number of bytes that can be written before power is cut, negative for no limit
+long flashWriteBudget = -1;
+
+// Expected configuration
+char expected[VERBALEYES_CONFIGLEN];
+
+
+
+// VerbalEyes function to read from flash
+void verbaleyes_flash_read(const uint32_t addr, uint8_t* data, const uint16_t len) {
+	if (addr + len > FLASHLEN) {
+		fprintf(stderr, "" COLOR_RED "Journal tried to read outside flash: %u %u\n" COLOR_NORMAL, addr, len);
+		exit(EXIT_FAILURE);
+	}
+	memcpy(data, flash + addr, len);
+	flashBytesRead += len;
+}
+
+// VerbalEyes function to write to flash, stops writing when power is cut
+void verbaleyes_flash_write(const uint32_t addr, const uint8_t* data, const uint16_t len) {
+	if (addr + len > FLASHLEN) {
+		fprintf(stderr, "" COLOR_RED "Journal tried to write outside flash: %u %u\n" COLOR_NORMAL, addr, len);
+		exit(EXIT_FAILURE);
+	}
+	for (uint16_t i = 0; i < len; i++) {
+		if (flashWriteBudget == 0) return;
+		if (flashWriteBudget > 0) flashWriteBudget--;
+		if (flash[addr + i] != 0xFF) {
+			fprintf(stderr, "" COLOR_RED "Journal wrote to flash that was not erased: %u\n" COLOR_NORMAL, addr + i);
+			numberOfErrors++;
+		}
+		flash[addr + i] &= data[i];
+	}
+}
+
+// VerbalEyes function to erase a flash sector
+void verbaleyes_flash_erase(const uint32_t addr) {
+	if (addr % VERBALEYES_JOURNAL_SECTORSIZE || addr >= FLASHLEN) {
+		fprintf(stderr, "" COLOR_RED "Journal tried to erase an invalid sector: %u\n" COLOR_NORMAL, addr);
+		exit(EXIT_FAILURE);
+	}
+	if (flashWriteBudget == 0) return;
+	memset(flash + addr, 0xFF, VERBALEYES_JOURNAL_SECTORSIZE);
+	flashErases[addr / VERBALEYES_JOURNAL_SECTORSIZE]++;
+}
+
+
+
+// Prints test start message
+void testStart(const char* title) {
+	printf("" COLOR_BLUE "Testing journal: %s\n" COLOR_NORMAL, title);
+	fflush(stdout);
+}
+
+// Prints test end message
+void testEnd() {
+	printf("" COLOR_GREEN "Test complete\n\n" COLOR_NORMAL);
+	fflush(stdout);
+}
+
+// Erases entire flash and mounts empty journal
+void clearFlash() {
+	memset(flash, 0xFF, FLASHLEN);
+	memset(flashErases, 0, sizeof(flashErases));
+	memset(expected, 0, VERBALEYES_CONFIGLEN);
+	flashWriteBudget = -1;
+	verbaleyes_journal_mount();
+}
+
+// Writes a string to configuration and commits it
+void commitString(const uint16_t addr, const char* str) {
+	const uint16_t len = strlen(str);
+	for (uint16_t i = 0; i < len; i++) verbaleyes_conf_write(addr + i, str[i]);
+	while (verbaleyes_conf_commit(addr, len) == VERBALEYES_COMMIT_WORKING);
+}
+
+// Compares configuration with expected configuration, returns false if it did not match
+bool matchesExpected() {
+	for (uint16_t i = 0; i < VERBALEYES_CONFIGLEN; i++) {
+		if (verbaleyes_conf_read(i) != expected[i]) return false;
+	}
+	return true;
+}
+
+// Compares configuration after a simulated reboot with expected configuration
+void compareAfterMount() {
+	verbaleyes_journal_mount();
+	if (matchesExpected()) {
+		printf("" COLOR_GREEN "Configuration matched after mount\n" COLOR_NORMAL);
+	}
+	else {
+		fprintf(stderr, "" COLOR_RED "Configuration did not match after mount\n" COLOR_NORMAL);
+		numberOfErrors++;
+	}
+}
+
+
+
+// Tests journal storage backend
+void testJournal() {
+	// Tests that an empty flash mounts to an empty configuration
+	testStart("Empty flash");
+	clearFlash();
+	compareAfterMount();
+	testEnd();
+
+	// Tests that a committed change survives a reboot
+	testStart("Commit");
+	clearFlash();
+	commitString(0, "ssid");
+	memcpy(expected, "ssid", 4);
+	commitString(100, "host");
+	memcpy(expected + 100, "host", 4);
+	compareAfterMount();
+	testEnd();
+
+	// Tests that uncommitted changes do not survive a reboot
+	testStart("Uncommitted change");
+	clearFlash();
+	commitString(0, "abc");
+	memcpy(expected, "abc", 3);
+	verbaleyes_conf_write(0, 'x');
+	compareAfterMount();
+	testEnd();
+
+	// Tests that compaction does not persist changes that were never committed
+	testStart("Uncommitted change during compaction");
+	clearFlash();
+	commitString(0, "abc");
+	memcpy(expected, "abc", 3);
+	verbaleyes_conf_write(0, 'x');
+	for (int i = 0; i < 100; i++) {
+		commitString(100, "0123456789");
+		verbaleyes_journal_poll();
+	}
+	memcpy(expected + 100, "0123456789", 10);
+	compareAfterMount();
+	testEnd();
+
+	// Tests that many commits wrap around all sectors and wear them evenly
+	testStart("Wear levelling");
+	clearFlash();
+	for (int i = 0; i < 200; i++) {
+		char str[9];
+		snprintf(str, sizeof(str), "%08d", i);
+		commitString((i * 13) % (VERBALEYES_CONFIGLEN - 8), str);
+		memcpy(expected + (i * 13) % (VERBALEYES_CONFIGLEN - 8), str, 8);
+		if (i % 3 == 0) verbaleyes_journal_poll();
+	}
+	compareAfterMount();
+	int minErases = flashErases[0];
+	int maxErases = flashErases[0];
+	for (int i = 1; i < VERBALEYES_JOURNAL_SECTORS; i++) {
+		if (flashErases[i] < minErases) minErases = flashErases[i];
+		if (flashErases[i] > maxErases) maxErases = flashErases[i];
+	}
+	if (minErases > 0 && maxErases - minErases <= 1) {
+		printf("" COLOR_GREEN "Erases were spread across all sectors: %d %d\n" COLOR_NORMAL, minErases, maxErases);
+	}
+	else {
+		fprintf(stderr, "" COLOR_RED "Erases were not spread across all sectors: %d %d\n" COLOR_NORMAL, minErases, maxErases);
+		numberOfErrors++;
+	}
+	testEnd();
+
+	// Tests that mounting only reads the start of every sector and the active sector
+	testStart("Mount reads");
+	flashBytesRead = 0;
+	verbaleyes_journal_mount();
+	if (flashBytesRead <= VERBALEYES_JOURNAL_SECTORS * 16 + 2 * VERBALEYES_JOURNAL_SECTORSIZE) {
+		printf("" COLOR_GREEN "Mount read %ld bytes\n" COLOR_NORMAL, flashBytesRead);
+	}
+	else {
+		fprintf(stderr, "" COLOR_RED "Mount read too much: %ld bytes\n" COLOR_NORMAL, flashBytesRead);
+		numberOfErrors++;
+	}
+	testEnd();
+
+	// Tests that power loss at any byte of a commit gives either the old or the new configuration
+	testStart("Power loss");
+	char before[VERBALEYES_CONFIGLEN];
+	char after[VERBALEYES_CONFIGLEN];
+	int failures = 0;
+	for (int cut = 0; cut < 2 * VERBALEYES_JOURNAL_SECTORSIZE; cut++) {
+		clearFlash();
+		for (int i = 0; i < 6; i++) {
+			commitString(i * 20, "0123456789abcdefghij");
+		}
+		for (uint16_t i = 0; i < VERBALEYES_CONFIGLEN; i++) before[i] = verbaleyes_conf_read(i);
+		flashWriteBudget = cut;
+		for (int i = 0; i < 6; i++) {
+			commitString(i * 20, "ABCDEFGHIJ");
+		}
+		for (uint16_t i = 0; i < VERBALEYES_CONFIGLEN; i++) after[i] = verbaleyes_conf_read(i);
+		flashWriteBudget = -1;
+		verbaleyes_journal_mount();
+
+		// Every commit is atomic so every 20 byte block is either old or new
+		for (int i = 0; i < 6; i++) {
+			char block[20];
+			for (int j = 0; j < 20; j++) block[j] = verbaleyes_conf_read(i * 20 + j);
+			if (memcmp(block, before + i * 20, 20) && memcmp(block, after + i * 20, 20)) failures++;
+		}
+
+		// Journal can be written to again after power loss
+		commitString(200, "x");
+		before[200] = 'x';
+		verbaleyes_journal_mount();
+		if (verbaleyes_conf_read(200) != 'x') failures++;
+	}
+	if (failures) {
+		fprintf(stderr, "" COLOR_RED "Configuration was corrupted after power loss %d times\n" COLOR_NORMAL, failures);
+		numberOfErrors++;
+	}
+	else {
+		printf("" COLOR_GREEN "Configuration survived power loss\n" COLOR_NORMAL);
+	}
+	testEnd();
+}
+
+int main(void) {
+	testJournal();
+
+	// Prints the number of errors that occured
+	printf("\n\n" COLOR_BLUE "RESULT:\n" COLOR_NORMAL);
+	printf((numberOfErrors) ? COLOR_RED : COLOR_GREEN);
+	printf("Number of errors: %d\n", numberOfErrors);
+	printf("" COLOR_NORMAL);
+	return (numberOfErrors) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -6,14 +6,17 @@
 #include "./helpers/print_colors.h"
 
 // Use same random number sequence for every test
-clock_t clock() { return 1; }
+uint32_t verbaleyes_seed() { return 1; }
 
 // Noop
 void verbaleyes_network_connect(const char* ssid, const char* key) {}
 void verbaleyes_socket_connect(const char* host, const unsigned short port) {}
-void verbaleyes_socket_write(const uint8_t* str, const size_t len) {}
+size_t verbaleyes_socket_write(const uint8_t* str, const size_t len) { return len; }
 void verbaleyes_conf_write(const unsigned short addr, const char c) {}
-void verbaleyes_conf_commit() {}
+int8_t verbaleyes_conf_commit(const unsigned short addr, const unsigned short len) { return VERBALEYES_COMMIT_DONE; }
+
+// Time does not move
+uint32_t verbaleyes_millis() { return 0; }
 
 // Is connected right away
 int8_t verbaleyes_network_connected() { return 1; }
@@ -23,7 +26,7 @@ int8_t verbaleyes_socket_connected() { return 1; }
 char verbaleyes_conf_read(const unsigned short addr) { return 0; }
 
 // Response data
-char socket_read_data[] = "\0http/1.1 101 OK\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: KM6afhWtO4bb/E9amIx6hTrgkCw=\r\n\r\n\0\x81\x09" "authed789\0";
+char socket_read_data[] = "\0http/1.1 101 OK\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: A90w8aBkQD2ztaf1WEClfVxuVGM=\r\n\r\n\0\x81\x09" "authed789\0";
 int socket_read_index = 0;
 short verbaleyes_socket_read() {
 	unsigned char c = socket_read_data[socket_read_index++];
@@ -49,11 +49,13 @@ document.querySelector("#webserial-read").onchange = async function () {
 
 // Uploads configuration over web serial
 document.querySelector('#webserial-upload').onclick = async function () {
-	// Gets serialized data
-	const data = serializeConfig();
-
 	// Aborts if there is no data to be written
-	if (data === "\n") return;
+	if (serializeConfig() === "\n") return;
+
+	// Gets serialized data as text or as a binary frame
+	const data = (document.querySelector('#webserial-binary').checked) ?
+		serialDevice.serializeBinary(document.querySelectorAll(".config-textbox"), "name") :
+		serializeConfig();
 
 	// Connects to device if not connected already
 	await connectWebSerial();
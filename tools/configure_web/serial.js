@@ -108,16 +108,90 @@ SerialDevice.prototype.serialize = function (iterable, keyName = "key", valueNam
 	}).join('') + '\n';
 };
 
+/**
+ * Address and max length for all configuration items, max length 0 is an unsigned integer and -1 a signed integer
+ */
+SerialDevice.confItems = {
+	ssid: [ 0, 32 ],
+	ssidkey: [ 32, 63 ],
+	host: [ 95, 64 ],
+	port: [ 159, 0 ],
+	path: [ 161, 32 ],
+	proj: [ 193, 32 ],
+	projkey: [ 225, 32 ],
+	speedmin: [ 257, -1 ],
+	speedmax: [ 259, -1 ],
+	deadzone: [ 261, 0 ],
+	callow: [ 263, 0 ],
+	calhigh: [ 265, 0 ],
+	sensitivity: [ 267, 0 ],
+	proj2: [ 269, 32 ],
+	projkey2: [ 301, 32 ],
+	proj3: [ 333, 32 ],
+	projkey3: [ 365, 32 ],
+	proj4: [ 397, 32 ],
+	projkey4: [ 429, 32 ],
+	maxrate: [ 461, 0 ]
+};
+
+/**
+ * Calculates CRC-16/CCITT-FALSE checksum used by binary configuration frames
+ */
+SerialDevice.crc16 = function (bytes) {
+	let crc = 0xffff;
+	for (const byte of bytes) {
+		crc ^= byte << 8;
+		for (let i = 0; i < 8; i++) {
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+		}
+	}
+	return crc;
+};
+
+/**
+ * Serializes an iterable list of HTML nodes to a binary configuration frame
+ * The frame is followed by a LF to exit configuration mode like the text protocol
+ */
+SerialDevice.prototype.serializeBinary = function (iterable, keyName = "key", valueName = "value") {
+	// Creates one record with address, length and data for every item with a value
+	const payload = [];
+	for (const elem of iterable) {
+		if (!elem[valueName]) continue;
+		const [ addr, len ] = SerialDevice.confItems[elem[keyName]];
+		let data;
+		if (len <= 0) {
+			// Clamps value to the same range as text configuration does
+			const [ min, max ] = (len === 0) ? [ 0, 65535 ] : [ -32767, 32767 ];
+			const value = Math.min(Math.max(Math.trunc(Number(elem[valueName])) || 0, min), max) & 0xffff;
+			data = [ value >> 8, value & 0xff ];
+		}
+		else {
+			data = Array.from(new TextEncoder().encode(elem[valueName]).slice(0, len));
+			if (data.length < len) data.push(0);
+		}
+		payload.push(addr >> 8, addr & 0xff, data.length >> 8, data.length & 0xff, ...data);
+	}
+
+	// Creates frame with version, payload length, payload and CRC
+	const frame = [ 1, payload.length >> 8, payload.length & 0xff, ...payload ];
+	const crc = SerialDevice.crc16(frame);
+	return new Uint8Array([ 0x02, ...frame, crc >> 8, crc & 0xff, '\n'.charCodeAt(0) ]);
+};
+
 /**
  * @TODO add documentation
+ * Data can either be a string or a Uint8Array created by serializeBinary
  */
 SerialDevice.prototype.write = async function (data) {
 	// Creates writer for serial device
 	const writer = this.port.writable.getWriter();
 
+	// Encodes strings, binary data is already encoded
+	if (typeof data === "string") data = new TextEncoder().encode(data);
+
 	// Only writes data if a reader already exists
 	if (this.reader) {
-		await writer.write(new TextEncoder().encode(data));
+		await writer.write(data);
 		await writer.close();
 	}
 	// Creates reader and writes data if no reader is available
@@ -126,7 +200,7 @@ SerialDevice.prototype.write = async function (data) {
 		this.reader = this.port.readable.getReader();
 
 		// Writes data
-		const writeProgress = writer.write(new TextEncoder().encode(data));
+		const writeProgress = writer.write(data);
 
 		// Flushes data until configuration logs
 		let buffer = "";
@@ -153,6 +227,8 @@ SerialDevice.prototype.write = async function (data) {
 			buffer = buffer.slice(index + 1);
 			if (
 				chunk.includes("Configuration saved\r\n") ||
+				chunk.includes("Configuration unchanged\r\n") ||
+				chunk.includes("Configuration could not be saved\r\n") ||
 				chunk.includes("Configureation canceled\r\n")
 			) {
 				this.printCallback(chunk.slice(0, chunk.indexOf('\n') + 1));